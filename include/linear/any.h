@@ -16,6 +16,34 @@ namespace linear {
 
 namespace type {
 
+/// @cond hidden
+// types that any stores inline, without allocating a msgpack::zone
+template <typename T>
+struct is_inline_value {
+  static const bool value = false;
+};
+#define LINEAR_TYPE_INLINE_VALUE(T)             \
+  template <>                                   \
+  struct is_inline_value<T> {                   \
+    static const bool value = true;             \
+  };
+LINEAR_TYPE_INLINE_VALUE(bool)
+LINEAR_TYPE_INLINE_VALUE(char)
+LINEAR_TYPE_INLINE_VALUE(signed char)
+LINEAR_TYPE_INLINE_VALUE(unsigned char)
+LINEAR_TYPE_INLINE_VALUE(short)
+LINEAR_TYPE_INLINE_VALUE(unsigned short)
+LINEAR_TYPE_INLINE_VALUE(int)
+LINEAR_TYPE_INLINE_VALUE(unsigned int)
+LINEAR_TYPE_INLINE_VALUE(long)
+LINEAR_TYPE_INLINE_VALUE(unsigned long)
+LINEAR_TYPE_INLINE_VALUE(long long)
+LINEAR_TYPE_INLINE_VALUE(unsigned long long)
+LINEAR_TYPE_INLINE_VALUE(float)
+LINEAR_TYPE_INLINE_VALUE(double)
+#undef LINEAR_TYPE_INLINE_VALUE
+/// @endcond
+
 /**
  * @class any any.h "linear/any.h"
  * represent any type object
@@ -37,42 +65,65 @@ class any {
   };
 
   /// @cond hidden
-  any() : zone_(), object_(), type(NIL) {
+  any() : zone_(NULL), object_(), type(NIL) {
   }
-  any(const any& a) : zone_() {
-    copy_msgpack_object(a.object_, &object_, zone_);
-    type = static_cast<linear::type::any::Type>(object_.type);
+  any(const any& a) : zone_(NULL), object_(), type(NIL) {
+    assign_object(a.object_);
   }
-  any(const linear::type::nil&) : zone_(), object_(), type(NIL) {
+  any(const linear::type::nil&) : zone_(NULL), object_(), type(NIL) {
   }
-  any(const msgpack::object& o) : zone_() {
-    copy_msgpack_object(o, &object_, zone_);
-    type = static_cast<linear::type::any::Type>(object_.type);
+  any(const msgpack::object& o) : zone_(NULL), object_(), type(NIL) {
+    assign_object(o);
   }
   template <typename Value>
-  any(const Value& value) : zone_(), object_(value, zone_), type(static_cast<linear::type::any::Type>(object_.type)) {
+  any(const Value& value) : zone_(NULL), object_(), type(NIL) {
+    assign_value(value, value_tag<is_inline_value<Value>::value>());
+  }
+#if !defined(MSGPACK_USE_CPP03)
+  any(any&& a) noexcept : zone_(a.zone_), object_(a.object_), type(a.type) {
+    a.zone_ = NULL;
+    a.object_ = msgpack::object();
+    a.type = NIL;
   }
+#endif
   ~any() {
+    delete zone_;
   }
   template <typename Value>
   any& operator=(const Value& value) {
-    zone_.clear();
-    object_ = msgpack::object(value, zone_);
-    type = static_cast<linear::type::any::Type>(object_.type);
+    assign_value(value, value_tag<is_inline_value<Value>::value>());
+    return *this;
+  }
+  any& operator=(const linear::type::nil&) {
+    release_zone();
+    object_ = msgpack::object();
+    type = NIL;
     return *this;
   }
   any& operator=(const any& a) {
-    zone_.clear();
-    copy_msgpack_object(a.object_, &object_, zone_);
-    type = static_cast<linear::type::any::Type>(object_.type);
+    if (this != &a) {
+      assign_object(a.object_);
+    }
     return *this;
   }
   any& operator=(const msgpack::object& o) {
-    zone_.clear();
-    copy_msgpack_object(o, &object_, zone_);
-    type = static_cast<linear::type::any::Type>(object_.type);
+    assign_object(o);
+    return *this;
+  }
+#if !defined(MSGPACK_USE_CPP03)
+  any& operator=(any&& a) noexcept {
+    if (this != &a) {
+      delete zone_;
+      zone_ = a.zone_;
+      object_ = a.object_;
+      type = a.type;
+      a.zone_ = NULL;
+      a.object_ = msgpack::object();
+      a.type = NIL;
+    }
     return *this;
   }
+#endif
   bool operator<(const any& a) const {
     return (stringify() < a.stringify());
   }
@@ -100,11 +151,11 @@ class any {
     return object_;
   }
   /**
-   * get internal msgpack::zone reference.
+   * get internal msgpack::zone pointer.
    * @warning return value is for referencing only.
-   * @return msgpack::zone
+   * @return msgpack::zone, or NULL while the object is nil or a scalar
    */
-  const msgpack::zone& zone() const {
+  const msgpack::zone* zone() const {
     return zone_;
   }
   /// @endcond
@@ -154,16 +205,88 @@ class any {
     pk.pack(object_);
   }
   void msgpack_unpack(msgpack::object o) {
-    zone_.clear();
-    copy_msgpack_object(o, &object_, zone_);
+    assign_object(o);
   }
   template <typename MSGPACK_OBJECT>
   void msgpack_object(MSGPACK_OBJECT* o, msgpack::zone& z) const {
     copy_msgpack_object(object_, o, z);
   }
+  /**
+   * take over an unpacked object without copying it.
+   * @warning o must live in z. z is released into this any unless o is nil or a scalar.
+   */
+  void msgpack_adopt(const msgpack::object& o, msgpack::unique_ptr<msgpack::zone>& z) {
+    if (need_zone(o)) {
+      delete zone_;
+      zone_ = z.release();
+    } else {
+      release_zone();
+    }
+    object_ = o;
+    type = static_cast<linear::type::any::Type>(object_.type);
+  }
   /// @endcond
 
  private:
+  template <bool Inline>
+  struct value_tag {
+  };
+
+  // nil and scalars live in object_ itself, so only strings, binaries,
+  // exts and non-empty containers ever allocate a zone.
+  static bool need_zone(const msgpack::object& o) {
+    switch (o.type) {
+    case msgpack::type::STR:
+    case msgpack::type::BIN:
+    case msgpack::type::EXT:
+      return true;
+    case msgpack::type::ARRAY:
+      return (o.via.array.size != 0);
+    case msgpack::type::MAP:
+      return (o.via.map.size != 0);
+    default:
+      return false;
+    }
+  }
+
+  msgpack::zone& prepare_zone() {
+    if (zone_) {
+      zone_->clear();
+    } else {
+      zone_ = new msgpack::zone();
+    }
+    return *zone_;
+  }
+
+  void release_zone() {
+    delete zone_;
+    zone_ = NULL;
+  }
+
+  template <typename Value>
+  void assign_value(const Value& value, value_tag<true>) {
+    release_zone();
+    object_ = msgpack::object(value);
+    type = static_cast<linear::type::any::Type>(object_.type);
+  }
+
+  template <typename Value>
+  void assign_value(const Value& value, value_tag<false>) {
+    msgpack::zone& z = prepare_zone();
+    object_ = msgpack::object(value, z);
+    type = static_cast<linear::type::any::Type>(object_.type);
+  }
+
+  void assign_object(const msgpack::object& o) {
+    if (need_zone(o)) {
+      copy_msgpack_object(o, &object_, prepare_zone());
+    } else {
+      release_zone();
+      object_ = o;
+    }
+    type = static_cast<linear::type::any::Type>(object_.type);
+  }
+
   static int isnprint(char c) {
     return !isprint(c);
   }
@@ -256,7 +379,7 @@ class any {
     }
   }
 
-  msgpack::zone   zone_;
+  msgpack::zone*  zone_;
   msgpack::object object_;
 
 public:
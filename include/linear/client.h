@@ -6,7 +6,10 @@
 #ifndef LINEAR_CLIENT_H_
 #define LINEAR_CLIENT_H_
 
+#include "linear/error.h"
 #include "linear/event_loop.h"
+#include "linear/stats.h"
+#include "linear/worker_pool.h"
 
 namespace linear {
 
@@ -23,6 +26,34 @@ class LINEAR_EXTERN Client {
   virtual ~Client() {}
   /// @endcond
 
+  /**
+   * Run handler callbacks on a worker pool instead of the EventLoop thread
+   * @param [in] workers worker pool, which may be shared with other servers and clients
+   * @return linear::Error object
+   * @see linear::WorkerPool
+   */
+  linear::Error SetWorkerPool(const linear::WorkerPool& workers) const;
+  /**
+   * Start or stop recording latencies of requests per method
+   * @param [in] enable true to record
+   * default == false
+   * @return linear::Error object
+   * @note records the time spent in Handler::OnMessage for received requests,
+   * and the round trip time of sent requests until their responses.
+   * requests of up to 256 methods are recorded separately,
+   * and the others are summed under an empty name.
+   * @see linear::MethodLatency
+   */
+  linear::Error SetLatencyStats(bool enable) const;
+  /**
+   * get latencies of requests per method
+   * @param [in] reset true to start the next period from zero
+   * @return linear::MethodLatencies
+   * @note does not stop recording: a request finishing at the same time
+   * falls into either this snapshot or the next one
+   */
+  linear::MethodLatencies GetLatencyStats(bool reset = false) const;
+
  protected:
   /// @cond hidden
   linear::shared_ptr<linear::ClientImpl> client_;
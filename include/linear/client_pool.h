@@ -0,0 +1,110 @@
+/**
+ * @file client_pool.h
+ * ClientPool class definition
+ **/
+
+#ifndef LINEAR_CLIENT_POOL_H_
+#define LINEAR_CLIENT_POOL_H_
+
+#include <vector>
+
+#include "linear/message.h"
+#include "linear/socket.h"
+
+namespace linear {
+
+class ClientPoolImpl;
+
+/**
+ * @class ClientPool client_pool.h "linear/client_pool.h"
+ * ClientPool class.
+ * spreads requests over several connected sockets, to one or more servers.
+ * members that are not connected, or whose requests sent through the pool failed several times
+ * in a row (send errors, timeouts and error responses), are skipped until they recover.
+ *
+ @code
+ linear::TCPClient client(handler);
+ linear::ClientPool pool(linear::ClientPool::POWER_OF_TWO_CHOICES);
+ for (int i = 0; i < 4; i++) {
+   linear::TCPSocket socket = client.CreateSocket("127.0.0.1", 37800);
+   socket.Connect();
+   pool.Add(socket);
+ }
+ linear::Request request("echo", params);
+ linear::Error err = pool.Send(request, 1000);
+ @endcode
+ */
+class LINEAR_EXTERN ClientPool {
+ public:
+  //! how to choose a member for each request
+  enum Policy {
+    ROUND_ROBIN,          //!< next healthy member in turn
+    LEAST_OUTSTANDING,    //!< member with the fewest in-flight requests
+    POWER_OF_TWO_CHOICES  //!< the less loaded of two random healthy members
+  };
+  //! consecutive failed requests that eject a member
+  static const size_t DEFAULT_MAX_FAILURES = 3;
+  //! how long an ejected member is skipped (msec)
+  static const unsigned int DEFAULT_EJECTION_TIME = 5000;
+
+  /**
+   * Constructor
+   * @param [in] policy linear::ClientPool::Policy
+   */
+  explicit ClientPool(linear::ClientPool::Policy policy = POWER_OF_TWO_CHOICES);
+  /// @cond hidden
+  ~ClientPool();
+  /// @endcond
+
+  /**
+   * add a socket to the pool.
+   * @param [in] socket linear::Socket created by any client
+   * @note the pool does not connect the socket
+   */
+  void Add(const linear::Socket& socket) const;
+  /**
+   * remove a socket from the pool.
+   * @param [in] socket linear::Socket
+   */
+  void Remove(const linear::Socket& socket) const;
+  /**
+   * get all members, healthy or not.
+   * @return socket vector
+   */
+  std::vector<linear::Socket> GetMembers() const;
+  /**
+   * choose a healthy member by the policy.
+   * @return linear::Socket, or an invalid linear::Socket(GetId() == -1) if there is no healthy member
+   */
+  linear::Socket Select() const;
+  /**
+   * send a request through a member chosen by the policy.
+   * @param [in] request linear::Request
+   * @param [in] timeout request timeout (msec)
+   * @return linear::Error object, LNR_ENOTCONN if there is no healthy member
+   */
+  linear::Error Send(const linear::Request& request, int timeout = 30000) const;
+  /**
+   * skip a member for the ejection time, e.g. from linear::Handler::OnError on LNR_ETIMEDOUT.
+   * @param [in] socket linear::Socket
+   */
+  void Eject(const linear::Socket& socket) const;
+  /**
+   * change the policy.
+   * @param [in] policy linear::ClientPool::Policy
+   */
+  void SetPolicy(linear::ClientPool::Policy policy) const;
+  /**
+   * change the ejection rule.
+   * @param [in] max_failures consecutive failed requests that eject a member, 0 to never eject
+   * @param [in] ejection_time how long an ejected member is skipped (msec)
+   */
+  void SetEjection(size_t max_failures, unsigned int ejection_time) const;
+
+ private:
+  linear::shared_ptr<linear::ClientPoolImpl> pool_;
+};
+
+}  // namespace linear
+
+#endif  // LINEAR_CLIENT_POOL_H_
@@ -8,6 +8,7 @@
 #include <vector>
 #include <set>
 
+#include "linear/memory.h"
 #include "linear/socket.h"
 
 /**
@@ -25,6 +26,14 @@ namespace linear {
  */
 class LINEAR_EXTERN Group {
  public:
+  /**
+   * immutable set of linear::Socket that belonged to a group at some moment.
+   * Join and Leave never modify a snapshot that was handed out.
+   * @note GetSnapshot never copies the members: Join and Leave modify them in place,
+   * or copy them once when a snapshot of them is still held.
+   */
+  typedef linear::shared_ptr<const std::set<linear::Socket> > Snapshot;
+
   /**
    * get list of group names.
    * @return group name vector
@@ -36,6 +45,12 @@ class LINEAR_EXTERN Group {
    * @return socket set
    */
   static std::set<linear::Socket> Get(const std::string& name);
+  /**
+   * get the current members of the specific group without copying them.
+   * @param name group name
+   * @return snapshot of the members (empty set for unknown group, never NULL)
+   */
+  static Snapshot GetSnapshot(const std::string& name);
   /**
    * joins the specific linear::Socket to the specific group.
    * @param name group name
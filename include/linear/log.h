@@ -6,6 +6,7 @@
 #ifndef LINEAR_LOG_H_
 #define LINEAR_LOG_H_
 
+#include <cstddef>
 #include <string>
 
 #include "linear/private/extern.h"
@@ -17,14 +18,20 @@
 # define __LINEAR_PRETTY_FUNCTION__ __PRETTY_FUNCTION__
 #endif
 
+// logs more verbose than LINEAR_LOG_COMPILE_LEVEL are compiled out,
+// arguments included: -1(off), 0(err), 1(warn), 2(info), 3(debug), 4(full)
+#ifndef LINEAR_LOG_COMPILE_LEVEL
+# define LINEAR_LOG_COMPILE_LEVEL 4
+#endif
+
 #define LINEAR_LOG(level, format, ...)                                  \
-  if (linear::log::DoPrint(level)) {                                    \
+  if ((level) <= LINEAR_LOG_COMPILE_LEVEL && linear::log::DoPrint(level)) { \
     linear::log::Print(false, level, __FILE__, __LINE__, __LINEAR_PRETTY_FUNCTION__, format, ##__VA_ARGS__); \
   }
 
 #ifdef _LINEAR_LOG_DEBUG_
 #define LINEAR_DEBUG(level, format, ...)                                \
-  if (linear::log::DoPrint(level)) {                                    \
+  if ((level) <= LINEAR_LOG_COMPILE_LEVEL && linear::log::DoPrint(level)) { \
     linear::log::Print(true, level, __FILE__, __LINE__, __LINEAR_PRETTY_FUNCTION__, format, ##__VA_ARGS__); \
   }
 #else
@@ -110,9 +117,19 @@ LINEAR_EXTERN linear::log::Level GetLevel();
  *
  * default level is LOG_ERR
  * @param level [in] linear::log::Level level of output log
+ * @note logs above GetCompileLevel() are not output at any level
  **/
 LINEAR_EXTERN void SetLevel(linear::log::Level level);
 
+/**
+ * get the most verbose log level compiled into the library
+ *
+ * LOG_FULL unless the library is built with --with-log-level (configure)
+ * or -Dlog_level (gyp)
+ * @return linear::log::Level
+ **/
+LINEAR_EXTERN linear::log::Level GetCompileLevel();
+
 /**
  * show logs to stderr
  * @note call DisableStderr() at the end of your application
@@ -133,6 +150,32 @@ LINEAR_EXTERN bool EnableFile(const std::string& filename);
  **/
 LINEAR_EXTERN bool EnableCallback(linear::log::LogCallback function);
 
+/**
+ * write logs on a background thread
+ *
+ * LINEAR_LOG only copies each log into a lock-free ring buffer,
+ * and the thread writes them to stderr, file and callback in batches,
+ * so that event loops do not wait for disk I/O.
+ * @param capacity [in] number of logs the ring buffer holds (rounded up to a power of 2)
+ * @param block [in] true: wait for space when the buffer is full,
+ * false: drop the log and count it (see GetDroppedLogs())
+ * @note the callback given to EnableCallback() is called on the background thread.
+ * call DisableAsync() before DisableStderr(), DisableFile() or DisableCallback(),
+ * so that buffered logs are written out
+ **/
+LINEAR_EXTERN bool EnableAsync(size_t capacity = 8192, bool block = false);
+
+/**
+ * write buffered logs out, stop the background thread and write logs directly again
+ **/
+LINEAR_EXTERN void DisableAsync();
+
+/**
+ * get number of logs dropped because the buffer of EnableAsync() was full
+ * @return number of logs
+ **/
+LINEAR_EXTERN size_t GetDroppedLogs();
+
 /**
  * hide logs from stderr
  **/
@@ -10,6 +10,8 @@
 #include <limits.h>
 #include <stdint.h>
 
+#include <utility>
+
 #include "linear/any.h"
 #include "linear/socket.h"
 
@@ -38,6 +40,9 @@ static const message_type_t UNDEFINED = 3;
 /**
  * @class Message message.h "linear/message.h"
  * Super class of several concrete messages
+ * @note
+ * With C++11, Request, Response and Notify get implicit move constructors and
+ * move assignments, which take over params, result and error without copying.
  */
 class LINEAR_EXTERN Message {
  public:
@@ -110,6 +115,14 @@ class LINEAR_EXTERN Request : public linear::Message {
    @endcode
    */
   Request(const std::string& m, const linear::type::any& p);
+#if !defined(MSGPACK_USE_CPP03)
+  /**
+   * Request Constructor taking over the parameter
+   * @param m method name
+   * @param p parameter, moved into params without copying
+   */
+  Request(const std::string& m, linear::type::any&& p);
+#endif
 
   /**
    * send request to peer node with timeout == 30sec
@@ -252,6 +265,15 @@ class LINEAR_EXTERN Response : public linear::Message {
    @endcode
    */
   Response(uint32_t id, const linear::type::any& r) : Message(linear::RESPONSE), msgid(id), result(r) {}
+#if !defined(MSGPACK_USE_CPP03)
+  /**
+   * Valid Response Constructor taking over the result
+   * @param id msgid of request
+   * @param r result, moved into result without copying
+   */
+  Response(uint32_t id, linear::type::any&& r)
+    : Message(linear::RESPONSE), msgid(id), result(std::move(r)) {}
+#endif
   /**
    * Error Response Constructor
    * @param id msgid of request\n
@@ -284,6 +306,16 @@ class LINEAR_EXTERN Response : public linear::Message {
    */
   Response(uint32_t id, const linear::type::any& r, const linear::type::any& e)
     : Message(linear::RESPONSE), msgid(id), result(r), error(e) {}
+#if !defined(MSGPACK_USE_CPP03)
+  /**
+   * Error Response Constructor taking over the result and the error
+   * @param id msgid of request
+   * @param r result must be linear::type::nil()
+   * @param e error, moved into error without copying
+   */
+  Response(uint32_t id, linear::type::any&& r, linear::type::any&& e)
+    : Message(linear::RESPONSE), msgid(id), result(std::move(r)), error(std::move(e)) {}
+#endif
   /**
    * send response to peer node
    * @param socket linear::Socket object
@@ -371,6 +403,14 @@ class LINEAR_EXTERN Notify : public linear::Message {
    @endcode
    */
   Notify(const std::string& m, const linear::type::any& p) : Message(linear::NOTIFY), method(m), params(p) {}
+#if !defined(MSGPACK_USE_CPP03)
+  /**
+   * Notify Constructor taking over the parameter
+   * @param m method name
+   * @param p parameter, moved into params without copying
+   */
+  Notify(const std::string& m, linear::type::any&& p) : Message(linear::NOTIFY), method(m), params(std::move(p)) {}
+#endif
   /**
    * send notify to peer node
    * @param socket linear::Socket object
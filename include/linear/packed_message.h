@@ -0,0 +1,88 @@
+/**
+ * @file packed_message.h
+ * PackedMessage class definition
+ */
+
+#ifndef LINEAR_PACKED_MESSAGE_H_
+#define LINEAR_PACKED_MESSAGE_H_
+
+#include "linear/message.h"
+
+namespace linear {
+
+class SharedBuffer;
+
+/**
+ * @class PackedMessage packed_message.h "linear/packed_message.h"
+ * Immutable Request, Response or Notify serialized once.
+ * Sending it does neither pack nor copy the payload again,
+ * so the same message can be sent to many sockets, many times.
+ * Copies of PackedMessage share the same buffer.
+ *
+ @code
+ linear::Notify notify("heartbeat", status);
+ linear::PackedMessage packed(notify);
+ for (std::vector<linear::Socket>::iterator it = sockets.begin(); it != sockets.end(); it++) {
+   packed.Send(*it);
+ }
+ @endcode
+ */
+class LINEAR_EXTERN PackedMessage {
+ public:
+  /**
+   * create empty packed message, which fails to send.
+   */
+  PackedMessage();
+  /**
+   * pack message.
+   * @param message linear::Request, linear::Response or linear::Notify
+   * @note a Request is sent with its msgid and timeout as they are at this time
+   */
+  explicit PackedMessage(const linear::Message& message);
+  PackedMessage(const PackedMessage& message);
+  PackedMessage& operator=(const PackedMessage& message);
+  ~PackedMessage();
+
+  /**
+   * get original message
+   * @return linear::Message or NULL if empty
+   * @see linear::Message::as
+   */
+  const linear::Message* GetMessage() const;
+  /**
+   * get packed size
+   * @return byte size or 0 if empty
+   */
+  size_t GetSize() const;
+  /**
+   * send packed message to peer node
+   * @param socket linear::Socket object
+   * @return linear::Error object
+   * @see linear::Socket::Send
+   */
+  linear::Error Send(const linear::Socket& socket) const;
+  /**
+   * send packed message to group
+   * @param group_name socket group
+   * @see linear::Group
+   */
+  void Send(const std::string& group_name) const;
+  /**
+   * send packed message to group except for specified socket
+   * @param group_name socket group
+   * @param except_socket excepting socket
+   * @see linear::Group
+   */
+  void Send(const std::string& group_name, const linear::Socket& except_socket) const;
+
+  /// @cond hidden
+  const linear::shared_ptr<const linear::SharedBuffer>& GetBuffer() const;
+  /// @endcond
+
+ private:
+  linear::shared_ptr<const linear::SharedBuffer> buffer_;
+};
+
+}  // namespace linear
+
+#endif  // LINEAR_PACKED_MESSAGE_H_
@@ -8,6 +8,8 @@
 
 #include "linear/error.h"
 #include "linear/event_loop.h"
+#include "linear/stats.h"
+#include "linear/worker_pool.h"
 
 namespace linear {
 
@@ -16,6 +18,19 @@ class ServerImpl;
 /**
  * @class Server server.h "linear/server.h"
  * Super class for several concrete server classes
+ * @note
+ * A server accepts, reads and writes on the EventLoop given at construction.
+ * One listening port cannot be spread over several EventLoops, because of libtv:
+ * - tv_listen(tv_stream_t*, const char* host, const char* port, int backlog, cb)
+ *   creates and binds the listening socket itself and takes no flags, so
+ *   SO_REUSEPORT cannot be set before bind (tv_setsockopt needs a stream that
+ *   already has a socket, like linear::Socket::SetSockOpt).
+ * - libtv has no counterpart of uv_tcp_open to adopt an accepted fd into a
+ *   stream of another loop, and the accept callback
+ *   (tv_stream_t* server, tv_stream_t* client, int status) hands over a client
+ *   already bound to the loop of the server.
+ * To use more cores on one port, run the handlers on a WorkerPool
+ * (see SetWorkerPool), or create servers on separate EventLoops and ports.
  */
 class LINEAR_EXTERN Server {
  public:
@@ -31,6 +46,51 @@ class LINEAR_EXTERN Server {
    * @return linear::Error object
    */
   virtual linear::Error SetMaxClients(size_t max_clients) const;
+  /**
+   * Run handler callbacks on a worker pool instead of the EventLoop thread
+   * @param [in] workers worker pool, which may be shared with other servers and clients
+   * @return linear::Error object
+   * @see linear::WorkerPool
+   */
+  linear::Error SetWorkerPool(const linear::WorkerPool& workers) const;
+  /**
+   * Set length of the queue of pending connections
+   * @param [in] backlog number of pending connections
+   * default == 128, capped by the kernel (net.core.somaxconn on Linux)
+   * @return linear::Error object
+   * @note takes effect at the next Start.
+   * Raise it when many clients connect at once, e.g. after a failover:
+   * connections over the backlog are dropped and clients retry after
+   * a delay of a second or more.
+   */
+  linear::Error SetBacklog(int backlog) const;
+  /**
+   * get statistics summed over the sockets accepted by the server.
+   * @return linear::Stats
+   * @note does not walk the sockets: each socket adds to the sums as it goes,
+   * and counters keep the share of disconnected sockets.
+   */
+  linear::Stats GetStats() const;
+  /**
+   * Start or stop recording latencies of requests per method
+   * @param [in] enable true to record
+   * default == false
+   * @return linear::Error object
+   * @note records the time spent in Handler::OnMessage for received requests,
+   * and the round trip time of sent requests until their responses.
+   * requests of up to 256 methods are recorded separately,
+   * and the others are summed under an empty name.
+   * @see linear::MethodLatency
+   */
+  linear::Error SetLatencyStats(bool enable) const;
+  /**
+   * get latencies of requests per method
+   * @param [in] reset true to start the next period from zero
+   * @return linear::MethodLatencies
+   * @note does not stop recording: a request finishing at the same time
+   * falls into either this snapshot or the next one
+   */
+  linear::MethodLatencies GetLatencyStats(bool reset = false) const;
   /**
    * Starts a server with specified parameters.
    * @param [in] hostname IPAddr or FQDN of host
@@ -9,10 +9,14 @@
 #include "linear/addrinfo.h"
 #include "linear/error.h"
 #include "linear/memory.h"
+#include "linear/msgpack_inc.h"
+#include "linear/stats.h"
 
 namespace linear {
 
+class ClientPoolImpl;
 class Message;
+class PackedMessage;
 class SocketImpl;
 
 /**
@@ -46,6 +50,23 @@ class LINEAR_EXTERN Socket {
     KEEPALIVE_WS,  //!< use WS_KEEPALIVE
   };
 
+  /**
+   * @struct ReconnectPolicy socket.h "linear/socket.h"
+   * how a client socket reconnects after its connection is lost.
+   * the n-th attempt waits min(initial_delay * 2^(n-1), max_delay) msec,
+   * shortened by a random fraction up to jitter.
+   * @see linear::Socket::SetReconnect
+   */
+  struct ReconnectPolicy {
+    ReconnectPolicy()
+      : initial_delay(100), max_delay(30000), max_attempts(0), jitter(0.5), max_outbox(1024) {}
+    unsigned int initial_delay; //!< delay before the first attempt (msec)
+    unsigned int max_delay;     //!< upper bound of the delay (msec)
+    unsigned int max_attempts;  //!< attempts before giving up, 0 for no limit
+    double jitter;              //!< 0.0 (no jitter) to 1.0 (delay is uniform in [0, delay])
+    size_t max_outbox;          //!< notifies held while reconnecting
+  };
+
  public:
   /// @cond hidden
   Socket();
@@ -92,6 +113,31 @@ class LINEAR_EXTERN Socket {
    * @see linear::Socket::DEFAULT_MAX_BUFFER_SIZE
    */
   virtual linear::Error SetMaxRecvBufferSize(size_t limit) const;
+  /**
+   * coalesce writes.
+   * Messages sent during one event loop iteration are packed into one buffer
+   * and written at once, at the cost of a short delay.
+   * @param [in] enable true: coalesce writes, false: write each message immediately (default)
+   * @return linear::Error object
+   * @note
+   * Messages queued while connecting are always written at once.
+   */
+  linear::Error SetWriteCoalescing(bool enable) const;
+  /**
+   * reconnect automatically when the connection is lost or fails to connect.
+   * While waiting to reconnect, the socket is DISCONNECTED and:
+   * - linear::Notify is held in an outbox (up to max_outbox, then LNR_ENOBUFS) and sent on reconnect
+   * - linear::Request and linear::Response fail with LNR_ENOTCONN
+   * Handler::OnDisconnect is called on each loss, and Handler::OnConnect on each reconnect.
+   * Disconnect() stops reconnecting and cancels the outbox with LNR_ECANCELED.
+   * @param [in] enable true: reconnect, false: do not reconnect (default)
+   * @param [in] policy linear::Socket::ReconnectPolicy
+   * @return linear::Error object, LNR_EINVAL for sockets accepted by servers
+   * @note requests in flight when the connection is lost are cancelled with LNR_ECANCELED,
+   * because the peer may have processed them.
+   */
+  linear::Error SetReconnect(bool enable,
+                             const linear::Socket::ReconnectPolicy& policy = linear::Socket::ReconnectPolicy()) const;
   /**
    * connect to target.
    * @param [in] timeout connect timeout(msec)\n
@@ -161,15 +207,55 @@ class LINEAR_EXTERN Socket {
    * @return linear::Addrinfo
    */
   virtual const linear::Addrinfo& GetPeerInfo() const;
+  /**
+   * get number of requests waiting for their responses.
+   * @return number of in-flight requests
+   * @note requests queued before the socket connects are not counted
+   * @see linear::ClientPool
+   */
+  size_t GetOutstandingRequests() const;
+  /**
+   * get statistics of the socket.
+   * @return linear::Stats
+   * @note cheap enough to be polled periodically for every socket.
+   */
+  linear::Stats GetStats() const;
+
+  /**
+   * send packed message.
+   * @param [in] message linear::PackedMessage
+   * @return linear::Error object
+   * @see linear::PackedMessage
+   */
+  linear::Error Send(const linear::PackedMessage& message) const;
 
   // @cond hidden
   virtual linear::Error Send(const linear::Message& message, int timeout = 30000) const;
   // @endcond
 
+#if !defined(MSGPACK_USE_CPP03)
+  /**
+   * send message taking over its params, result and error, without any deep copy.
+   * @param [in] message linear::Request, linear::Response or linear::Notify to be moved from
+   * @param [in] timeout request timeout (msec), ignored for others
+   * @return linear::Error object
+   * @note not virtual, so that the layout of Socket does not depend on the C++ version
+   *
+   @code
+   linear::Request request("foo", Foo());
+   socket.Send(std::move(request), 1000);
+   @endcode
+   */
+  linear::Error Send(linear::Message&& message, int timeout = 30000) const;
+#endif
+
  protected:
   // @cond hidden
   linear::shared_ptr<SocketImpl> socket_;
   // @endcond
+
+ private:
+  friend class linear::ClientPoolImpl;
 };
 
 }  // namespace linear
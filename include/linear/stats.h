@@ -0,0 +1,77 @@
+/**
+ * @file stats.h
+ * Runtime statistics and latency definitions
+ */
+
+#ifndef LINEAR_STATS_H_
+#define LINEAR_STATS_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+
+namespace linear {
+
+/**
+ * @struct Stats stats.h "linear/stats.h"
+ * runtime statistics of a socket, or of all sockets accepted by a server.
+ * counters grow from the creation of the socket or server,
+ * and gauges (send_queue_depth, outstanding_requests, connections) show the current value.
+ * @note fields are read one by one without a lock,
+ * so a snapshot is not consistent across fields.
+ * counters are kept in size_t, so they wrap at 2^32 on 32bit builds.
+ * @see linear::Socket::GetStats, linear::Server::GetStats
+ */
+struct Stats {
+  Stats()
+    : bytes_in(0), bytes_out(0), messages_in(0), messages_out(0),
+      send_queue_depth(0), outstanding_requests(0),
+      timeouts(0), decode_errors(0), reconnects(0), connections(0) {}
+  uint64_t bytes_in;             //!< bytes received
+  uint64_t bytes_out;            //!< bytes handed to the transport
+  uint64_t messages_in;          //!< messages received
+  uint64_t messages_out;         //!< messages handed to the transport
+  uint64_t send_queue_depth;     //!< messages queued or being written
+  uint64_t outstanding_requests; //!< requests waiting for their responses
+  uint64_t timeouts;             //!< requests timed out
+  uint64_t decode_errors;        //!< invalid, malformed or too big messages received
+  uint64_t reconnects;           //!< connections recovered by linear::Socket::SetReconnect
+  uint64_t connections;          //!< (server only) connected sockets
+};
+
+/**
+ * @struct Latency stats.h "linear/stats.h"
+ * distribution of latencies in microseconds.
+ * percentiles come from log-linear buckets, so they are accurate to about 3%.
+ * @see linear::MethodLatency
+ */
+struct Latency {
+  Latency()
+    : count(0), mean(0), minimum(0), maximum(0), p50(0), p90(0), p99(0), p999(0) {}
+  uint64_t count;   //!< number of samples
+  uint64_t mean;    //!< mean (usec)
+  uint64_t minimum; //!< minimum (usec)
+  uint64_t maximum; //!< maximum (usec)
+  uint64_t p50;     //!< 50th percentile (usec)
+  uint64_t p90;     //!< 90th percentile (usec)
+  uint64_t p99;     //!< 99th percentile (usec)
+  uint64_t p999;    //!< 99.9th percentile (usec)
+};
+
+/**
+ * @struct MethodLatency stats.h "linear/stats.h"
+ * latencies of the requests of a method.
+ * @see linear::Server::SetLatencyStats, linear::Client::SetLatencyStats
+ */
+struct MethodLatency {
+  linear::Latency service_time; //!< time spent in Handler::OnMessage for a received request
+  linear::Latency round_trip;   //!< time from sending a request to receiving its response
+};
+
+//! latencies keyed by method name
+typedef std::map<std::string, linear::MethodLatency> MethodLatencies;
+
+}  // namespace linear
+
+#endif  // LINEAR_STATS_H_
@@ -0,0 +1,81 @@
+/**
+ * @file worker_pool.h
+ * WorkerPool class definition
+ **/
+
+#ifndef LINEAR_WORKER_POOL_H_
+#define LINEAR_WORKER_POOL_H_
+
+#include <stddef.h>
+
+#include "linear/memory.h"
+#include "linear/private/extern.h"
+
+namespace linear {
+
+class WorkerPoolImpl;
+
+/**
+ * @class WorkerPool worker_pool.h "linear/worker_pool.h"
+ * WorkerPool class.
+ * runs Handler callbacks on worker threads instead of the EventLoop thread.
+ * callbacks for one socket run one at a time, in the order the events occurred.
+ * @see linear::Server::SetWorkerPool, linear::Client::SetWorkerPool
+ *
+ @code
+ linear::WorkerPool workers(8, 4096);
+ linear::TCPServer server(handler);
+ server.SetWorkerPool(workers);
+ server.Start("0.0.0.0", 37800);
+ @endcode
+ */
+class LINEAR_EXTERN WorkerPool {
+ public:
+  /**
+   * Constructor
+   * @param [in] num_workers number of worker threads (at least 1)
+   * @param [in] max_queue_depth number of callbacks allowed to wait for a worker.
+   * OnMessage callbacks of requests and notifies which come while the queue is full
+   * are dropped and counted (see GetRejectedCount), so that neither an EventLoop nor
+   * a worker ever waits for room; a dropped request is left to time out on the peer.
+   * Responses, OnConnect, OnDisconnect and OnError are always queued.
+   */
+  explicit WorkerPool(size_t num_workers = 4, size_t max_queue_depth = 1024);
+  /// @cond hidden
+  ~WorkerPool();
+  const linear::shared_ptr<linear::WorkerPoolImpl> GetImpl() const;
+  /// @endcond
+
+  /**
+   * Get the number of worker threads
+   * @return number of worker threads
+   */
+  size_t GetNumWorkers() const;
+  /**
+   * Get the maximum queue depth
+   * @return number of callbacks allowed to wait for a worker
+   */
+  size_t GetMaxQueueDepth() const;
+  /**
+   * Get the current queue depth
+   * @return number of callbacks waiting for a worker now
+   */
+  size_t GetQueueDepth() const;
+  /**
+   * Get the peak queue depth
+   * @return the largest queue depth seen so far
+   */
+  size_t GetPeakQueueDepth() const;
+  /**
+   * Get the number of dropped callbacks
+   * @return number of OnMessage callbacks (requests and notifies) dropped because the queue was full
+   */
+  size_t GetRejectedCount() const;
+
+ private:
+  linear::shared_ptr<linear::WorkerPoolImpl> pool_;
+};
+
+}  // namespace linear
+
+#endif  // LINEAR_WORKER_POOL_H_
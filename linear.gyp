@@ -61,18 +61,25 @@
         'src/addrinfo.cpp',
         'src/auth_context.cpp',
         'src/auth_context_impl.cpp',
+        'src/client.cpp',
+        'src/client_pool.cpp',
+        'src/client_pool_impl.cpp',
         'src/condition_variable.cpp',
         'src/error.cpp',
         'src/event_loop.cpp',
         'src/event_loop_impl.cpp',
         'src/group.cpp',
         'src/handler_delegate.cpp',
+        'src/latency_stats.cpp',
         'src/log.cpp',
+        'src/log_async.cpp',
         'src/log_file.cpp',
         'src/log_function.cpp',
         'src/log_stderr.cpp',
         'src/message.cpp',
         'src/mutex.cpp',
+        'src/packed_message.cpp',
+        'src/resolver.cpp',
         'src/server.cpp',
         'src/socket.cpp',
         'src/socket_impl.cpp',
@@ -83,11 +90,14 @@
         'src/tcp_socket_impl.cpp',
         'src/timer.cpp',
         'src/timer_impl.cpp',
+        'src/timer_wheel.cpp',
         'src/ws_client.cpp',
         'src/ws_server.cpp',
         'src/ws_server_impl.cpp',
         'src/ws_socket.cpp',
         'src/ws_socket_impl.cpp',
+        'src/worker_pool.cpp',
+        'src/worker_pool_impl.cpp',
       ],
       'actions': [
         {
@@ -108,6 +118,9 @@
           'msvs_cygwin_shell': 0,
         },
       ],
+      'defines': [
+        'LINEAR_LOG_COMPILE_LEVEL=<(log_level)',
+      ],
       'conditions': [
         [ 'with_ssl != "false"', {
           'defines': [
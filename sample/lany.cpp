@@ -0,0 +1,62 @@
+// linear type::any checker
+
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "linear/any.h"
+
+#define DEFAULT_TRY_NUM (1000000)
+
+static double Now() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000000000.0 + tv.tv_usec * 1000.0; // nsec
+}
+
+void usage(char* name) {
+  std::cout << "linear type::any checker." << std::endl;
+  std::cout << "creates and copies the result, error and params of a response." << std::endl;
+  std::cout << "a scalar response must not allocate, so it must be much cheaper than a string one." << std::endl << std::endl;
+  std::cout << "Usage: " << std::string(name) << " [options]" << std::endl;
+  std::cout << "  -n Num  : Set num of responses per condition.     default := 1000000" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  int ch;
+  extern char* optarg;
+
+  int num = DEFAULT_TRY_NUM;
+
+  while ((ch = getopt(argc, argv, "n:")) != -1) {
+    switch(ch) {
+    case 'n':
+      num = atoi(optarg);
+      num = (num <= 0) ? DEFAULT_TRY_NUM : num;
+      break;
+    default:
+      usage(argv[0]);
+      return -1;
+    }
+  }
+
+  std::cout << "--- Results ---" << std::endl;
+  double start = Now();
+  for (int i = 0; i < num; i++) {
+    linear::type::any result(i), error((linear::type::nil())), params;
+    linear::type::any result_copy(result), error_copy(error), params_copy(params);
+    result_copy = error;
+  }
+  std::cout << "Scalar response: " << (Now() - start) / num << " ns/op" << std::endl;
+
+  start = Now();
+  for (int i = 0; i < num; i++) {
+    linear::type::any result(std::string("result")), error((linear::type::nil())), params;
+    linear::type::any result_copy(result), error_copy(error), params_copy(params);
+  }
+  std::cout << "String response: " << (Now() - start) / num << " ns/op" << std::endl;
+  return 0;
+}
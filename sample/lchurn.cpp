@@ -0,0 +1,263 @@
+// linear connection churn checker
+
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "linear/condition_variable.h"
+#include "linear/tcp_server.h"
+#include "linear/tcp_client.h"
+#include "linear/log.h"
+
+#define DEFAULT_TRY_NUM (100000)
+#define DEFAULT_CONCURRENCY (100)
+
+using namespace linear::log;
+
+static double Now() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0; // msec
+}
+
+namespace server {
+
+// counts accepts and closes each connection at once,
+// so that TIME_WAIT stays on the server side
+class Handler : public linear::Handler {
+ public:
+  Handler() : accepted_(0) {}
+  ~Handler() {}
+
+  void OnConnect(const linear::Socket& socket) {
+    {
+      linear::lock_guard<linear::mutex> lock(mutex_);
+      accepted_++;
+    }
+    socket.Disconnect();
+  }
+  size_t GetAccepted() {
+    linear::lock_guard<linear::mutex> lock(mutex_);
+    return accepted_;
+  }
+
+ private:
+  size_t accepted_;
+  linear::mutex mutex_;
+};
+
+} // namespace server
+
+namespace client {
+
+// keeps `concurrency` connections in flight until `num` have been closed,
+// and measures the time from Connect to OnConnect
+class Handler : public linear::Handler {
+ public:
+  Handler(const std::string& host, int port, size_t num)
+    : client_(NULL), host_(host), port_(port), num_(num), started_(0), finished_(0), failed_(0) {}
+  ~Handler() {}
+
+  void SetClient(linear::TCPClient* client) {
+    client_ = client;
+  }
+  void Start(size_t concurrency) {
+    for (size_t i = 0; i < concurrency; i++) {
+      Connect();
+    }
+  }
+  void OnConnect(const linear::Socket& socket) {
+    linear::lock_guard<linear::mutex> lock(mutex_);
+    std::map<int, double>::iterator it = connecting_.find(socket.GetId());
+    if (it != connecting_.end()) {
+      latencies_.push_back(Now() - it->second);
+      connecting_.erase(it);
+    }
+  }
+  void OnDisconnect(const linear::Socket& socket, const linear::Error& error) {
+    {
+      linear::lock_guard<linear::mutex> lock(mutex_);
+      connecting_.erase(socket.GetId());
+    }
+    if (Finish(error.Code() != linear::LNR_OK && error.Code() != linear::LNR_EOF)) {
+      Connect();
+    }
+  }
+  void WaitToFinish() {
+    linear::unique_lock<linear::mutex> lock(mutex_);
+    while (finished_ < num_) {
+      cv_.wait(lock);
+    }
+  }
+  size_t GetFailed() {
+    linear::lock_guard<linear::mutex> lock(mutex_);
+    return failed_;
+  }
+  // connect latency (msec) at the given percentile
+  double GetLatency(double percentile) {
+    linear::lock_guard<linear::mutex> lock(mutex_);
+    if (latencies_.empty()) {
+      return 0;
+    }
+    std::sort(latencies_.begin(), latencies_.end());
+    size_t i = static_cast<size_t>(percentile / 100 * (latencies_.size() - 1));
+    return latencies_[i];
+  }
+
+ private:
+  void Connect() {
+    while (true) {
+      {
+        linear::lock_guard<linear::mutex> lock(mutex_);
+        if (started_ == num_) {
+          return;
+        }
+        started_++;
+      }
+      linear::TCPSocket s = client_->CreateSocket(host_, port_);
+      {
+        linear::lock_guard<linear::mutex> lock(mutex_);
+        connecting_[s.GetId()] = Now();
+      }
+      if (s.Connect().Code() == linear::LNR_OK) {
+        return;
+      }
+      {
+        linear::lock_guard<linear::mutex> lock(mutex_);
+        connecting_.erase(s.GetId());
+      }
+      if (!Finish(true)) {
+        return;
+      }
+    }
+  }
+  // returns false when all connections are done
+  bool Finish(bool failed) {
+    linear::lock_guard<linear::mutex> lock(mutex_);
+    finished_++;
+    if (failed) {
+      failed_++;
+    }
+    if (finished_ == num_) {
+      cv_.notify_one();
+      return false;
+    }
+    return true;
+  }
+
+  linear::TCPClient* client_;
+  std::string host_;
+  int port_;
+  size_t num_;
+  size_t started_;
+  size_t finished_;
+  size_t failed_;
+  std::map<int, double> connecting_;
+  std::vector<double> latencies_;
+  linear::mutex mutex_;
+  linear::condition_variable cv_;
+};
+
+} // namespace client
+
+void usage(char* name) {
+  std::cout << "linear connection churn checker." << std::endl;
+  std::cout << "runs a server and a client on separate event loops, and opens and closes connections." << std::endl << std::endl;
+  std::cout << "Usage: " << std::string(name) << " [options] [Host := 127.0.0.1] [Port := 10000]" << std::endl;
+  std::cout << "  -n Num  : Set num of connections.                 default := 100000" << std::endl;
+  std::cout << "  -b Num  : Set listen backlog of the server.       default := 128" << std::endl;
+  std::cout << "  -c Num  : Set num of concurrent connections.      default := 100" << std::endl;
+  std::cout << "  -l Level: Show log.                               default := off" << std::endl;
+  std::cout << "            ERR = 0, WARN = 1, INFO = 2, DEBUG = 3, FULL = 4" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  int ch, l;
+  extern char* optarg;
+  extern int optind;
+
+  size_t num = DEFAULT_TRY_NUM, concurrency = DEFAULT_CONCURRENCY;
+  int backlog = 0;
+  linear::log::Level level = linear::log::LOG_OFF;
+
+  while ((ch = getopt(argc, argv, "b:c:l:n:")) != -1) {
+    switch(ch) {
+    case 'b':
+      backlog = atoi(optarg);
+      break;
+    case 'c':
+      concurrency = atoi(optarg);
+      concurrency = (concurrency <= 0) ? DEFAULT_CONCURRENCY : concurrency;
+      break;
+    case 'l':
+      l = atoi(optarg);
+      if (l >= 0) {
+        level = (l < 4) ? static_cast<linear::log::Level>(l) : LOG_FULL;
+      }
+      break;
+    case 'n':
+      num = atoi(optarg);
+      num = (num <= 0) ? DEFAULT_TRY_NUM : num;
+      break;
+    default:
+      usage(argv[0]);
+      return -1;
+    }
+  }
+
+  argc -= optind;
+  argv += optind;
+
+  std::string host = (argc >= 1) ? std::string(argv[0]) : "127.0.0.1";
+  int port = (argc >= 2) ? atoi(argv[1]) : 10000;
+
+  if (level != LOG_OFF) {
+    linear::log::SetLevel(level);
+    linear::log::EnableStderr();
+  }
+
+  linear::shared_ptr<server::Handler> shandler = linear::shared_ptr<server::Handler>(new server::Handler());
+  linear::TCPServer s(shandler);
+  if (backlog > 0) {
+    s.SetBacklog(backlog);
+  }
+  linear::Error e = s.Start(host, port);
+  if (e.Code() != linear::LNR_OK) {
+    std::cerr << "fail to start server: " << e.Message() << std::endl;
+    return -1;
+  }
+
+  linear::EventLoop client_loop;
+  linear::shared_ptr<client::Handler> chandler = linear::shared_ptr<client::Handler>(new client::Handler(host, port, num));
+  linear::TCPClient c(chandler, client_loop);
+  chandler->SetClient(&c);
+
+  std::cout << "--- Conditions ---" << std::endl;
+  std::cout << "Target: " << host << ":" << port
+            << ", Num of connections: " << num << ", Concurrency: " << concurrency
+            << ", Backlog: " << ((backlog > 0) ? backlog : 128) << std::endl;
+
+  struct timeval start, end;
+  gettimeofday(&start, NULL);
+  chandler->Start(concurrency);
+  chandler->WaitToFinish();
+  gettimeofday(&end, NULL);
+
+  double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / (1000.0 * 1000.0);
+  size_t accepted = shandler->GetAccepted();
+  std::cout << "--- Result ---" << std::endl;
+  std::cout << "accepted: " << accepted << ", failed: " << chandler->GetFailed()
+            << ", elapsed: " << elapsed << "sec, "
+            << "accepts/sec: " << ((elapsed > 0) ? accepted / elapsed : 0) << std::endl;
+  std::cout << "connect latency: p50 = " << chandler->GetLatency(50) << "msec, "
+            << "p99 = " << chandler->GetLatency(99) << "msec, "
+            << "max = " << chandler->GetLatency(100) << "msec" << std::endl;
+  s.Stop();
+  return 0;
+}
@@ -0,0 +1,214 @@
+// linear send and receive loop checker
+
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "linear/condition_variable.h"
+#include "linear/tcp_server.h"
+#include "linear/tcp_client.h"
+#include "linear/log.h"
+
+#define DEFAULT_TRY_NUM (1000000)
+#define DEFAULT_WINDOW (64)
+#define DEFAULT_MSIZ (128)
+
+using namespace linear::log;
+
+// formats logs but does not write them,
+// so that the result shows the cost inside the library rather than I/O
+static void DiscardLog(linear::log::Level, const char*, int, const char*, const char*) {
+}
+
+namespace server {
+
+// echoes every notify
+class Handler : public linear::Handler {
+ public:
+  Handler() {}
+  ~Handler() {}
+
+  void OnMessage(const linear::Socket& socket, const linear::Message& msg) {
+    if (msg.type == linear::NOTIFY) {
+      msg.as<linear::Notify>().Send(socket);
+    }
+  }
+};
+
+} // namespace server
+
+namespace client {
+
+// keeps `window` notifies in flight until `num` have come back
+class Handler : public linear::Handler {
+ public:
+  Handler(size_t num, size_t window, size_t msiz)
+    : num_(num), window_(window), msiz_(msiz), sent_(0), received_(0), failed_(false) {}
+  ~Handler() {}
+
+  void OnConnect(const linear::Socket& socket) {
+    for (size_t i = 0; i < window_; i++) {
+      Send(socket);
+    }
+  }
+  void OnDisconnect(const linear::Socket&, const linear::Error&) {
+    Finish(true);
+  }
+  void OnMessage(const linear::Socket& socket, const linear::Message& msg) {
+    if (msg.type != linear::NOTIFY) {
+      return;
+    }
+    {
+      linear::lock_guard<linear::mutex> lock(mutex_);
+      received_++;
+    }
+    if (!Send(socket)) {
+      Finish(false);
+    }
+  }
+  void OnError(const linear::Socket& socket, const linear::Message&, const linear::Error&) {
+    socket.Disconnect();
+  }
+  // returns false when all notifies came back
+  bool WaitToFinish() {
+    linear::unique_lock<linear::mutex> lock(mutex_);
+    while (received_ < num_ && !failed_) {
+      cv_.wait(lock);
+    }
+    return !failed_;
+  }
+
+ private:
+  // returns false when all notifies have been sent
+  bool Send(const linear::Socket& socket) {
+    {
+      linear::lock_guard<linear::mutex> lock(mutex_);
+      if (sent_ == num_) {
+        return (received_ < num_);
+      }
+      sent_++;
+    }
+    linear::Notify notify("echo", std::string(msiz_, 'a'));
+    if (notify.Send(socket).Code() != linear::LNR_OK) {
+      socket.Disconnect();
+    }
+    return true;
+  }
+  void Finish(bool failed) {
+    linear::lock_guard<linear::mutex> lock(mutex_);
+    if (failed && received_ < num_) {
+      failed_ = true;
+    }
+    cv_.notify_one();
+  }
+
+  size_t num_;
+  size_t window_;
+  size_t msiz_;
+  size_t sent_;
+  size_t received_;
+  bool failed_;
+  linear::mutex mutex_;
+  linear::condition_variable cv_;
+};
+
+} // namespace client
+
+void usage(char* name) {
+  std::cout << "linear send and receive loop checker." << std::endl;
+  std::cout << "runs a server and a client on separate event loops, and echoes notifies between them." << std::endl;
+  std::cout << "build the library with and without --with-log-level, and run with -l to compare." << std::endl << std::endl;
+  std::cout << "Usage: " << std::string(name) << " [options] [Host := 127.0.0.1] [Port := 10000]" << std::endl;
+  std::cout << "  -n Num  : Set num of notifies.                    default := 1000000" << std::endl;
+  std::cout << "  -w Num  : Set num of notifies in flight.          default := 64" << std::endl;
+  std::cout << "  -m Size : Set message size.                       default := 128bytes" << std::endl;
+  std::cout << "  -l Level: Format logs and discard them.           default := off" << std::endl;
+  std::cout << "            ERR = 0, WARN = 1, INFO = 2, DEBUG = 3, FULL = 4" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  int ch, l;
+  extern char* optarg;
+  extern int optind;
+
+  size_t num = DEFAULT_TRY_NUM, window = DEFAULT_WINDOW, msiz = DEFAULT_MSIZ;
+  linear::log::Level level = linear::log::LOG_OFF;
+
+  while ((ch = getopt(argc, argv, "l:m:n:w:")) != -1) {
+    switch(ch) {
+    case 'l':
+      l = atoi(optarg);
+      if (l >= 0) {
+        level = (l < 4) ? static_cast<linear::log::Level>(l) : LOG_FULL;
+      }
+      break;
+    case 'm':
+      msiz = atoi(optarg);
+      msiz = (msiz <= 0) ? DEFAULT_MSIZ : msiz;
+      break;
+    case 'n':
+      num = atoi(optarg);
+      num = (num <= 0) ? DEFAULT_TRY_NUM : num;
+      break;
+    case 'w':
+      window = atoi(optarg);
+      window = (window <= 0) ? DEFAULT_WINDOW : window;
+      break;
+    default:
+      usage(argv[0]);
+      return -1;
+    }
+  }
+
+  argc -= optind;
+  argv += optind;
+
+  std::string host = (argc >= 1) ? std::string(argv[0]) : "127.0.0.1";
+  int port = (argc >= 2) ? atoi(argv[1]) : 10000;
+
+  if (level != LOG_OFF) {
+    linear::log::SetLevel(level);
+    linear::log::EnableCallback(DiscardLog);
+  }
+
+  linear::shared_ptr<server::Handler> shandler = linear::shared_ptr<server::Handler>(new server::Handler());
+  linear::TCPServer s(shandler);
+  linear::Error e = s.Start(host, port);
+  if (e.Code() != linear::LNR_OK) {
+    std::cerr << "fail to start server: " << e.Message() << std::endl;
+    return -1;
+  }
+
+  linear::EventLoop client_loop;
+  linear::shared_ptr<client::Handler> chandler = linear::shared_ptr<client::Handler>(new client::Handler(num, window, msiz));
+  linear::TCPClient c(chandler, client_loop);
+
+  std::cout << "--- Conditions ---" << std::endl;
+  std::cout << "Target: " << host << ":" << port
+            << ", Num of notifies: " << num << ", In flight: " << window
+            << ", Message size: " << msiz << "bytes" << std::endl;
+  std::cout << "Log level: " << static_cast<int>(level)
+            << ", compiled in: " << static_cast<int>(linear::log::GetCompileLevel()) << std::endl;
+
+  struct timeval start, end;
+  gettimeofday(&start, NULL);
+  linear::TCPSocket socket = c.CreateSocket(host, port);
+  socket.Connect();
+  bool ok = chandler->WaitToFinish();
+  gettimeofday(&end, NULL);
+  socket.Disconnect();
+  s.Stop();
+  if (!ok) {
+    std::cerr << "loop fail" << std::endl;
+    return -1;
+  }
+
+  double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / (1000.0 * 1000.0);
+  std::cout << "--- Result ---" << std::endl;
+  std::cout << "elapsed: " << elapsed << "sec, "
+            << "round trips/sec: " << ((elapsed > 0) ? num / elapsed : 0) << std::endl;
+  return 0;
+}
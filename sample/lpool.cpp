@@ -0,0 +1,74 @@
+// linear request pool checker
+
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "request_pool.h"
+
+#define DEFAULT_TRY_NUM (100000)
+
+static double Now() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000000000.0 + tv.tv_usec * 1000.0; // nsec
+}
+
+struct Entry {
+  linear::Request request;
+};
+
+void usage(char* name) {
+  std::cout << "linear request pool checker." << std::endl;
+  std::cout << "matches responses and adds requests with various numbers of outstanding requests." << std::endl;
+  std::cout << "the cost of matching must not depend on the number of outstanding requests." << std::endl << std::endl;
+  std::cout << "Usage: " << std::string(name) << " [options]" << std::endl;
+  std::cout << "  -n Num  : Set num of matches per condition.       default := 100000" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  int ch;
+  extern char* optarg;
+
+  int num = DEFAULT_TRY_NUM;
+
+  while ((ch = getopt(argc, argv, "n:")) != -1) {
+    switch(ch) {
+    case 'n':
+      num = atoi(optarg);
+      num = (num <= 0) ? DEFAULT_TRY_NUM : num;
+      break;
+    default:
+      usage(argv[0]);
+      return -1;
+    }
+  }
+
+  static const int outstandings[] = {1, 10, 100, 1000, 10000, 100000};
+  static const int N = sizeof(outstandings) / sizeof(outstandings[0]);
+
+  std::cout << "--- Results ---" << std::endl;
+  for (int i = 0; i < N; i++) {
+    linear::RequestPool<Entry> pool;
+    std::vector<Entry> entries(outstandings[i]);
+    for (std::vector<Entry>::iterator it = entries.begin(); it != entries.end(); it++) {
+      pool.Add(&(*it));
+    }
+    double start = Now();
+    for (int j = 0; j < num; j++) {
+      Entry& entry = entries[j % outstandings[i]];
+      if (pool.Remove(entry.request.msgid) != &entry) { // response
+        std::cerr << "fail to match msgid: " << entry.request.msgid << std::endl;
+        return -1;
+      }
+      pool.Add(&entry);                                 // next request
+    }
+    std::cout << "Outstanding requests: " << outstandings[i]
+              << ", Match + add: " << (Now() - start) / num << " ns/op" << std::endl;
+  }
+  return 0;
+}
@@ -2,33 +2,20 @@
 
 #include "linear/addrinfo.h"
 
+#include "resolver.h"
+
 namespace linear {
 
 Addrinfo::Addrinfo() : addr("undefined"), port(-1), proto(UNKNOWN) {
 }
 
 Addrinfo::Addrinfo(const std::string& a, int p) : addr("undefined"), port(-1), proto(UNKNOWN) {
-  struct addrinfo hints;
-  struct addrinfo* res = NULL;
-  memset(&hints, 0, sizeof(hints));
-  hints.ai_family = AF_INET;
-  int r = getaddrinfo(a.c_str(), NULL, &hints, &res);
-  if (r == 0) {
-    addr = a;
-    port = p;
-    proto = IPv4;
-    freeaddrinfo(res);
-    return;
-  }
-  hints.ai_family = AF_INET6;
-  r = getaddrinfo(a.c_str(), NULL, &hints, &res);
-  if (r == 0) {
+  Protocol resolved = Resolver::Resolve(a);
+  if (resolved != UNKNOWN) {
     addr = a;
     port = p;
-    proto = IPv6;
-    freeaddrinfo(res);
+    proto = resolved;
   }
-  return;
 }
 
 // ref: http://stackoverflow.com/questions/35551879/cast-from-sockaddr-to-sockaddr-in-increases-required-alignment
@@ -0,0 +1,203 @@
+#ifndef LINEAR_ATOMIC_OPS_H_
+#define LINEAR_ATOMIC_OPS_H_
+
+#ifdef _WIN32
+# include <windows.h>
+# include <intrin.h>
+#endif
+
+#include <stddef.h>
+
+// 64bit integers are word-sized, so the operations below apply to uint64_t
+#if defined(_WIN64) || defined(__LP64__) || defined(_LP64)
+# define LINEAR_ATOMIC_64
+#endif
+
+namespace linear {
+
+// Minimal atomic operations on word-sized integers (size_t, int, uint64_t on 64bit),
+// usable without C++11 <atomic>.
+// Acquire/Release order the surrounding memory accesses as in C++11;
+// Relaxed ones are atomic but unordered, for statistics counters.
+namespace atomic {
+
+#if defined(_WIN32)
+
+// x86/x64 loads and stores of aligned words are atomic,
+// and MSVC volatile accesses have acquire/release semantics
+template <typename T>
+inline T LoadRelaxed(const volatile T* p) {
+  return *p;
+}
+template <typename T>
+inline T LoadAcquire(const volatile T* p) {
+  T v = *p;
+  _ReadWriteBarrier();
+  return v;
+}
+template <typename T>
+inline void StoreRelaxed(volatile T* p, T v) {
+  *p = v;
+}
+template <typename T>
+inline void StoreRelease(volatile T* p, T v) {
+  _ReadWriteBarrier();
+  *p = v;
+}
+inline void FenceSeqCst() {
+  MemoryBarrier();
+}
+
+namespace detail {
+template <size_t N> struct Interlocked;
+template <> struct Interlocked<4> {
+  template <typename T>
+  static T CompareExchange(volatile T* p, T desired, T expected) {
+    return static_cast<T>(_InterlockedCompareExchange(reinterpret_cast<volatile long*>(p),
+                                                      static_cast<long>(desired),
+                                                      static_cast<long>(expected)));
+  }
+  template <typename T>
+  static T FetchAdd(volatile T* p, T v) {
+    return static_cast<T>(_InterlockedExchangeAdd(reinterpret_cast<volatile long*>(p), static_cast<long>(v)));
+  }
+  template <typename T>
+  static T Exchange(volatile T* p, T v) {
+    return static_cast<T>(_InterlockedExchange(reinterpret_cast<volatile long*>(p), static_cast<long>(v)));
+  }
+};
+template <> struct Interlocked<8> {
+  template <typename T>
+  static T CompareExchange(volatile T* p, T desired, T expected) {
+    return static_cast<T>(_InterlockedCompareExchange64(reinterpret_cast<volatile __int64*>(p),
+                                                        static_cast<__int64>(desired),
+                                                        static_cast<__int64>(expected)));
+  }
+  template <typename T>
+  static T FetchAdd(volatile T* p, T v) {
+    return static_cast<T>(_InterlockedExchangeAdd64(reinterpret_cast<volatile __int64*>(p), static_cast<__int64>(v)));
+  }
+  template <typename T>
+  static T Exchange(volatile T* p, T v) {
+    return static_cast<T>(_InterlockedExchange64(reinterpret_cast<volatile __int64*>(p), static_cast<__int64>(v)));
+  }
+};
+}  // namespace detail
+
+// on failure, *expected is updated to the current value
+template <typename T>
+inline bool CompareExchange(volatile T* p, T* expected, T desired) {
+  T prev = detail::Interlocked<sizeof(T)>::CompareExchange(p, desired, *expected);
+  if (prev == *expected) {
+    return true;
+  }
+  *expected = prev;
+  return false;
+}
+template <typename T>
+inline T FetchAdd(volatile T* p, T v) {
+  return detail::Interlocked<sizeof(T)>::FetchAdd(p, v);
+}
+template <typename T>
+inline T FetchAddRelaxed(volatile T* p, T v) {
+  return FetchAdd(p, v);
+}
+template <typename T>
+inline T Exchange(volatile T* p, T v) {
+  return detail::Interlocked<sizeof(T)>::Exchange(p, v);
+}
+
+#elif defined(__ATOMIC_ACQUIRE)  // gcc >= 4.7, clang
+
+template <typename T>
+inline T LoadRelaxed(const volatile T* p) {
+  return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+template <typename T>
+inline T LoadAcquire(const volatile T* p) {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+template <typename T>
+inline void StoreRelaxed(volatile T* p, T v) {
+  __atomic_store_n(p, v, __ATOMIC_RELAXED);
+}
+template <typename T>
+inline void StoreRelease(volatile T* p, T v) {
+  __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+inline void FenceSeqCst() {
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+// on failure, *expected is updated to the current value
+template <typename T>
+inline bool CompareExchange(volatile T* p, T* expected, T desired) {
+  return __atomic_compare_exchange_n(p, expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+template <typename T>
+inline T FetchAdd(volatile T* p, T v) {
+  return __atomic_fetch_add(p, v, __ATOMIC_ACQ_REL);
+}
+template <typename T>
+inline T FetchAddRelaxed(volatile T* p, T v) {
+  return __atomic_fetch_add(p, v, __ATOMIC_RELAXED);
+}
+template <typename T>
+inline T Exchange(volatile T* p, T v) {
+  return __atomic_exchange_n(p, v, __ATOMIC_ACQ_REL);
+}
+
+#else  // older gcc: __sync builtins are full barriers
+
+template <typename T>
+inline T LoadRelaxed(const volatile T* p) {
+  return *p;
+}
+template <typename T>
+inline T LoadAcquire(const volatile T* p) {
+  T v = *p;
+  __sync_synchronize();
+  return v;
+}
+template <typename T>
+inline void StoreRelaxed(volatile T* p, T v) {
+  *p = v;
+}
+template <typename T>
+inline void StoreRelease(volatile T* p, T v) {
+  __sync_synchronize();
+  *p = v;
+}
+inline void FenceSeqCst() {
+  __sync_synchronize();
+}
+template <typename T>
+inline bool CompareExchange(volatile T* p, T* expected, T desired) {
+  T prev = __sync_val_compare_and_swap(p, *expected, desired);
+  if (prev == *expected) {
+    return true;
+  }
+  *expected = prev;
+  return false;
+}
+template <typename T>
+inline T FetchAdd(volatile T* p, T v) {
+  return __sync_fetch_and_add(p, v);
+}
+template <typename T>
+inline T FetchAddRelaxed(volatile T* p, T v) {
+  return __sync_fetch_and_add(p, v);
+}
+template <typename T>
+inline T Exchange(volatile T* p, T v) {
+  T prev = *p;
+  while (!CompareExchange(p, &prev, v)) {}
+  return prev;
+}
+
+#endif
+
+}  // namespace atomic
+
+}  // namespace linear
+
+#endif  // LINEAR_ATOMIC_OPS_H_
@@ -0,0 +1,31 @@
+#include "linear/client.h"
+
+#include "client_impl.h"
+
+namespace linear {
+
+Error Client::SetWorkerPool(const WorkerPool& workers) const {
+  if (!client_) {
+    return Error(LNR_EINVAL);
+  }
+  client_->SetWorkerPool(workers.GetImpl());
+  return Error(LNR_OK);
+}
+
+Error Client::SetLatencyStats(bool enable) const {
+  if (!client_) {
+    return Error(LNR_EINVAL);
+  }
+  client_->SetLatencyStats(enable);
+  return Error(LNR_OK);
+}
+
+MethodLatencies Client::GetLatencyStats(bool reset) const {
+  MethodLatencies latencies;
+  if (client_) {
+    client_->GetLatencyStats(&latencies, reset);
+  }
+  return latencies;
+}
+
+} // namespace linear
@@ -12,6 +12,12 @@ class ClientImpl : public HandlerDelegate {
              bool show_ssl_version = false)
     : HandlerDelegate(handler, loop, show_ssl_version) {}
   virtual ~ClientImpl() {}
+  void SetLatencyStats(bool enable) {
+    latencies_->SetEnabled(enable);
+  }
+  void GetLatencyStats(linear::MethodLatencies* latencies, bool reset) {
+    latencies_->Snapshot(latencies, reset);
+  }
 };
 
 }
@@ -0,0 +1,47 @@
+#include "linear/client_pool.h"
+
+#include "client_pool_impl.h"
+
+namespace linear {
+
+ClientPool::ClientPool(ClientPool::Policy policy)
+  : pool_(new ClientPoolImpl(policy)) {
+  pool_->SetSelf(pool_);
+}
+
+ClientPool::~ClientPool() {
+}
+
+void ClientPool::Add(const Socket& socket) const {
+  pool_->Add(socket);
+}
+
+void ClientPool::Remove(const Socket& socket) const {
+  pool_->Remove(socket);
+}
+
+std::vector<Socket> ClientPool::GetMembers() const {
+  return pool_->GetMembers();
+}
+
+Socket ClientPool::Select() const {
+  return pool_->Select();
+}
+
+Error ClientPool::Send(const Request& request, int timeout) const {
+  return pool_->Send(request, timeout);
+}
+
+void ClientPool::Eject(const Socket& socket) const {
+  pool_->Eject(socket);
+}
+
+void ClientPool::SetPolicy(ClientPool::Policy policy) const {
+  pool_->SetPolicy(policy);
+}
+
+void ClientPool::SetEjection(size_t max_failures, unsigned int ejection_time) const {
+  pool_->SetEjection(max_failures, ejection_time);
+}
+
+} // namespace linear
@@ -0,0 +1,227 @@
+#include "linear/log.h"
+
+#include "client_pool_impl.h"
+#include "uv.h"
+
+using namespace linear::log;
+
+namespace linear {
+
+ClientPoolImpl::ClientPoolImpl(ClientPool::Policy policy)
+  : policy_(policy), next_(0), random_(static_cast<uint32_t>(uv_hrtime()) | 1),
+    max_failures_(ClientPool::DEFAULT_MAX_FAILURES),
+    ejection_time_(ClientPool::DEFAULT_EJECTION_TIME) {
+}
+
+ClientPoolImpl::~ClientPoolImpl() {
+}
+
+void ClientPoolImpl::SetSelf(const weak_ptr<ClientPoolImpl>& self) {
+  lock_guard<mutex> lock(mutex_);
+  self_ = self;
+}
+
+void ClientPoolImpl::Add(const Socket& socket) {
+  lock_guard<mutex> lock(mutex_);
+  for (std::vector<Member>::iterator it = members_.begin(); it != members_.end(); it++) {
+    if (it->socket == socket) {
+      return;
+    }
+  }
+  members_.push_back(Member(socket));
+  shared_ptr<ClientPoolImpl> self = self_.lock();
+  if (socket.socket_ && self) {
+    socket.socket_->AddRequestObserver(self);
+  }
+}
+
+void ClientPoolImpl::Remove(const Socket& socket) {
+  lock_guard<mutex> lock(mutex_);
+  for (std::vector<Member>::iterator it = members_.begin(); it != members_.end(); it++) {
+    if (it->socket == socket) {
+      members_.erase(it);
+      shared_ptr<ClientPoolImpl> self = self_.lock();
+      if (socket.socket_ && self) {
+        socket.socket_->RemoveRequestObserver(self);
+      }
+      return;
+    }
+  }
+}
+
+std::vector<Socket> ClientPoolImpl::GetMembers() const {
+  lock_guard<mutex> lock(mutex_);
+  std::vector<Socket> sockets;
+  sockets.reserve(members_.size());
+  for (std::vector<Member>::const_iterator it = members_.begin(); it != members_.end(); it++) {
+    sockets.push_back(it->socket);
+  }
+  return sockets;
+}
+
+Socket ClientPoolImpl::Select() {
+  lock_guard<mutex> lock(mutex_);
+  _CollectCandidates(Now());
+  if (candidates_.empty()) {
+    return Socket();
+  }
+  return members_[_Choose()].socket;
+}
+
+Error ClientPoolImpl::Send(const Request& request, int timeout) {
+  Socket socket;
+  {
+    lock_guard<mutex> lock(mutex_);
+    _CollectCandidates(Now());
+    if (candidates_.empty()) {
+      LINEAR_LOG(LOG_WARN, "fail to send request: no healthy member in pool");
+      return Error(LNR_ENOTCONN);
+    }
+    Member& member = members_[_Choose()];
+    socket = member.socket;
+    // before sending, as the response may come before Send returns
+    member.sent.insert(request.msgid);
+  }
+  Error err = socket.Send(request, timeout);
+  if (err != Error(LNR_OK)) {
+    lock_guard<mutex> lock(mutex_);
+    for (std::vector<Member>::iterator it = members_.begin(); it != members_.end(); it++) {
+      if (it->socket == socket && it->sent.erase(request.msgid) > 0) {
+        _Report(&(*it), false);
+        break;
+      }
+    }
+  }
+  return err;
+}
+
+void ClientPoolImpl::Eject(const Socket& socket) {
+  lock_guard<mutex> lock(mutex_);
+  for (std::vector<Member>::iterator it = members_.begin(); it != members_.end(); it++) {
+    if (it->socket == socket) {
+      LINEAR_LOG(LOG_INFO, "eject socket(id = %d) from pool for %u msec", socket.GetId(), ejection_time_);
+      it->failures = 0;
+      it->ejected_until = Now() + ejection_time_;
+      return;
+    }
+  }
+}
+
+void ClientPoolImpl::SetPolicy(ClientPool::Policy policy) {
+  lock_guard<mutex> lock(mutex_);
+  policy_ = policy;
+}
+
+void ClientPoolImpl::SetEjection(size_t max_failures, unsigned int ejection_time) {
+  lock_guard<mutex> lock(mutex_);
+  max_failures_ = max_failures;
+  ejection_time_ = ejection_time;
+}
+
+void ClientPoolImpl::OnRequestDone(int socket_id, uint32_t msgid, SocketImpl::RequestObserver::Outcome outcome) {
+  lock_guard<mutex> lock(mutex_);
+  for (std::vector<Member>::iterator it = members_.begin(); it != members_.end(); it++) {
+    if (it->socket.GetId() != socket_id) {
+      continue;
+    }
+    // requests sent to the socket directly are not the business of the pool,
+    // and a disconnected member is skipped anyway
+    if (it->sent.erase(msgid) > 0 && outcome != SocketImpl::RequestObserver::CANCELLED) {
+      _Report(&(*it), outcome == SocketImpl::RequestObserver::SUCCEEDED);
+    }
+    return;
+  }
+}
+
+uint64_t ClientPoolImpl::Now() {
+  return uv_hrtime() / 1000000; // msec
+}
+
+void ClientPoolImpl::_CollectCandidates(uint64_t now) {
+  candidates_.clear();
+  bool connected = false;
+  for (size_t i = 0; i < members_.size(); i++) {
+    if (members_[i].socket.GetState() != Socket::CONNECTED) {
+      continue;
+    }
+    connected = true;
+    if (members_[i].ejected_until <= now) {
+      candidates_.push_back(i);
+    }
+  }
+  // when every connected member is ejected, ejection is ignored rather than failing all requests
+  if (candidates_.empty() && connected) {
+    for (size_t i = 0; i < members_.size(); i++) {
+      if (members_[i].socket.GetState() == Socket::CONNECTED) {
+        candidates_.push_back(i);
+      }
+    }
+  }
+}
+
+size_t ClientPoolImpl::_Choose() {
+  switch (policy_) {
+  case ClientPool::ROUND_ROBIN:
+    {
+      // first candidate at or after next_
+      size_t chosen = candidates_[0];
+      for (size_t i = 0; i < candidates_.size(); i++) {
+        if (candidates_[i] >= next_) {
+          chosen = candidates_[i];
+          break;
+        }
+      }
+      next_ = chosen + 1;
+      return chosen;
+    }
+  case ClientPool::LEAST_OUTSTANDING:
+    {
+      size_t chosen = candidates_[0];
+      size_t least = members_[chosen].socket.GetOutstandingRequests();
+      for (size_t i = 1; i < candidates_.size(); i++) {
+        size_t outstanding = members_[candidates_[i]].socket.GetOutstandingRequests();
+        if (outstanding < least) {
+          chosen = candidates_[i];
+          least = outstanding;
+        }
+      }
+      return chosen;
+    }
+  case ClientPool::POWER_OF_TWO_CHOICES:
+  default:
+    {
+      if (candidates_.size() == 1) {
+        return candidates_[0];
+      }
+      size_t a = _Random() % candidates_.size();
+      size_t b = _Random() % (candidates_.size() - 1);
+      if (b >= a) {
+        b++; // distinct from a
+      }
+      size_t first = candidates_[a], second = candidates_[b];
+      return (members_[second].socket.GetOutstandingRequests() < members_[first].socket.GetOutstandingRequests())
+        ? second : first;
+    }
+  }
+}
+
+// xorshift32
+uint32_t ClientPoolImpl::_Random() {
+  random_ ^= random_ << 13;
+  random_ ^= random_ >> 17;
+  random_ ^= random_ << 5;
+  return random_;
+}
+
+void ClientPoolImpl::_Report(Member* member, bool ok) {
+  if (ok) {
+    member->failures = 0;
+  } else if (max_failures_ > 0 && ++member->failures >= max_failures_) {
+    LINEAR_LOG(LOG_INFO, "eject socket(id = %d) from pool for %u msec: %u consecutive failures",
+               member->socket.GetId(), ejection_time_, static_cast<unsigned int>(member->failures));
+    member->failures = 0;
+    member->ejected_until = Now() + ejection_time_;
+  }
+}
+
+}  // namespace linear
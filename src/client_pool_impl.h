@@ -0,0 +1,66 @@
+#ifndef LINEAR_CLIENT_POOL_IMPL_H_
+#define LINEAR_CLIENT_POOL_IMPL_H_
+
+#include <stdint.h>
+
+#include <set>
+#include <vector>
+
+#include "linear/client_pool.h"
+#include "linear/mutex.h"
+
+#include "socket_impl.h"
+
+namespace linear {
+
+// Members are kept in a vector: pools hold a handful of sockets, and every
+// policy needs a scan for healthy members anyway.
+// The pool observes how the requests it sent end, so that timeouts and error
+// responses count as failures as well as failed sends.
+class ClientPoolImpl : public linear::SocketImpl::RequestObserver {
+ public:
+  explicit ClientPoolImpl(linear::ClientPool::Policy policy);
+  ~ClientPoolImpl();
+
+  // the pool registers itself to member sockets through self
+  void SetSelf(const linear::weak_ptr<linear::ClientPoolImpl>& self);
+  void Add(const linear::Socket& socket);
+  void Remove(const linear::Socket& socket);
+  std::vector<linear::Socket> GetMembers() const;
+  linear::Socket Select();
+  linear::Error Send(const linear::Request& request, int timeout);
+  void Eject(const linear::Socket& socket);
+  void SetPolicy(linear::ClientPool::Policy policy);
+  void SetEjection(size_t max_failures, unsigned int ejection_time);
+  void OnRequestDone(int socket_id, uint32_t msgid, linear::SocketImpl::RequestObserver::Outcome outcome);
+
+ private:
+  struct Member {
+    explicit Member(const linear::Socket& s) : socket(s), failures(0), ejected_until(0) {}
+    linear::Socket socket;
+    size_t failures;          // consecutive failed requests
+    uint64_t ejected_until;   // msec
+    std::set<uint32_t> sent;  // msgids of requests sent through the pool and not done yet
+  };
+
+  static uint64_t Now();
+  // must be called under the lock
+  void _CollectCandidates(uint64_t now);
+  size_t _Choose();
+  uint32_t _Random();
+  void _Report(linear::ClientPoolImpl::Member* member, bool ok);
+
+  linear::weak_ptr<linear::ClientPoolImpl> self_;
+  mutable linear::mutex mutex_;
+  std::vector<Member> members_;
+  std::vector<size_t> candidates_; // scratch, indexes of members_
+  linear::ClientPool::Policy policy_;
+  size_t next_;
+  uint32_t random_;
+  size_t max_failures_;
+  unsigned int ejection_time_;
+};
+
+}  // namespace linear
+
+#endif  // LINEAR_CLIENT_POOL_IMPL_H_
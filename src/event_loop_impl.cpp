@@ -1,7 +1,10 @@
 #include <cstdlib>
+#include <vector>
 
 #include "server_impl.h"
+#include "shared_buffer.h"
 #include "timer_impl.h"
+#include "timer_wheel.h"
 
 using namespace linear::log;
 
@@ -55,6 +58,12 @@ void EventLoopImpl::OnClose(tv_handle_t* handle) {
       delete ev;
     }
     break;
+  case TIMER_WHEEL:
+    {
+      TimerWheelEvent* ev = static_cast<TimerWheelEvent*>(handle->data);
+      delete ev;
+    }
+    break;
   default:
     LINEAR_LOG(LOG_ERR, "BUG: invalid type of event");
     assert(false);
@@ -80,8 +89,35 @@ void EventLoopImpl::OnWrite(tv_write_t* request, int status) {
     socket->OnWrite(socket, message, status);
   }
   delete message;
-  free(request->buf.base);
-  free(request);
+  free(request); // buf.base is in the same allocation (see WriteBuffer)
+}
+
+void EventLoopImpl::OnBatchWrite(tv_write_t* request, int status) {
+  assert(request != NULL && request->data != NULL &&
+         request->handle != NULL && request->handle->data != NULL &&
+         request->buf.base != NULL);
+  std::vector<Message*>* messages = static_cast<std::vector<Message*>*>(request->data);
+  SocketEvent* ev = static_cast<SocketEvent*>(request->handle->data);
+  linear::shared_ptr<SocketImpl> socket = ev->socket.lock();
+  for (std::vector<Message*>::iterator it = messages->begin(); it != messages->end(); it++) {
+    if (socket) {
+      socket->OnWrite(socket, *it, status);
+    }
+    delete *it;
+  }
+  delete messages;
+  free(request); // buf.base is in the same allocation (see WriteBuffer)
+}
+
+void EventLoopImpl::OnSharedWrite(tv_write_t* request, int status) {
+  assert(request != NULL && request->data != NULL &&
+         request->handle != NULL && request->handle->data != NULL);
+  SharedWriteRequest* shared = static_cast<SharedWriteRequest*>(request->data);
+  SocketEvent* ev = static_cast<SocketEvent*>(request->handle->data);
+  if (linear::shared_ptr<SocketImpl> socket = ev->socket.lock()) {
+    socket->OnWrite(socket, &shared->buffer->GetMessage(), status);
+  }
+  delete shared; // releases the buffer when this is the last write of it
 }
 
 void EventLoopImpl::OnTimer(tv_timer_t* handle) {
@@ -92,6 +128,14 @@ void EventLoopImpl::OnTimer(tv_timer_t* handle) {
   }
 }
 
+void EventLoopImpl::OnTimerWheel(tv_timer_t* handle) {
+  assert(handle != NULL && handle->data != NULL);
+  TimerWheelEvent* ev = static_cast<TimerWheelEvent*>(handle->data);
+  if (linear::shared_ptr<TimerWheel> wheel = ev->wheel.lock()) {
+    wheel->OnTimer();
+  }
+}
+
 void EventLoopImpl::OnConnectTimeout(void* args) {
   assert(args != NULL);
   SocketEvent* ev = static_cast<SocketEvent*>(args);
@@ -100,28 +144,53 @@ void EventLoopImpl::OnConnectTimeout(void* args) {
   }
 }
 
+void EventLoopImpl::OnFlush(void* args) {
+  assert(args != NULL);
+  SocketEvent* ev = static_cast<SocketEvent*>(args);
+  if (linear::shared_ptr<SocketImpl> socket = ev->socket.lock()) {
+    socket->OnFlush(socket);
+  }
+}
+
+void EventLoopImpl::OnReconnect(void* args) {
+  assert(args != NULL);
+  SocketEvent* ev = static_cast<SocketEvent*>(args);
+  if (linear::shared_ptr<SocketImpl> socket = ev->socket.lock()) {
+    socket->OnReconnect(socket);
+  }
+}
+
 void EventLoopImpl::OnRequestTimeout(void* args) {
   assert(args != NULL);
   SocketImpl::RequestTimer* request_timer = static_cast<SocketImpl::RequestTimer*>(args);
+  // the timer is deleted by whoever removes it from the socket, which may be the socket destructor
   if (linear::shared_ptr<SocketImpl> socket = request_timer->socket.lock()) {
-    socket->OnRequestTimeout(socket, request_timer->request);
+    socket->OnRequestTimeout(socket, request_timer);
   }
-  delete request_timer;
 }
 
-EventLoopImpl::EventLoopImpl() : handle_(tv_loop_new()) {
+EventLoopImpl::EventLoopImpl() : handle_(tv_loop_new()), timer_wheel_(new TimerWheel(handle_)) {
   assert(handle_ != NULL);
+  TimerWheelEvent* ev = new TimerWheelEvent(timer_wheel_);
+  Error err = timer_wheel_->Init(ev);
+  if (err != Error(LNR_OK)) {
+    // requests sent on this loop fail with the error instead of never timing out
+    LINEAR_LOG(LOG_ERR, "requests on this loop cannot be sent: %s", err.Message().c_str());
+    delete ev;
+  }
 }
 
-EventLoopImpl::EventLoopImpl(const EventLoopImpl& loop) : handle_(loop.handle_) {
+EventLoopImpl::EventLoopImpl(const EventLoopImpl& loop) : handle_(loop.handle_), timer_wheel_(loop.timer_wheel_) {
 }
 
 EventLoopImpl& EventLoopImpl::operator=(const EventLoopImpl& loop) {
   handle_ = loop.handle_;
+  timer_wheel_ = loop.timer_wheel_;
   return *this;
 }
 
 EventLoopImpl::~EventLoopImpl() {
+  timer_wheel_->Close();
   tv_loop_delete(handle_);
 }
 
@@ -129,4 +198,8 @@ tv_loop_t* EventLoopImpl::GetHandle() const {
   return handle_;
 }
 
+const linear::shared_ptr<TimerWheel>& EventLoopImpl::GetTimerWheel() const {
+  return timer_wheel_;
+}
+
 }  // namespace linear
@@ -15,6 +15,7 @@ namespace linear {
 class ServerImpl;
 class SocketImpl;
 class TimerImpl;
+class TimerWheel;
 
 class EventLoopImpl {
  public:
@@ -22,6 +23,7 @@ class EventLoopImpl {
     SERVER,
     SOCKET,
     TIMER,
+    TIMER_WHEEL,
   };
   struct Event {
     Event(linear::EventLoopImpl::EventType t) : type(t) {}
@@ -43,6 +45,11 @@ class EventLoopImpl {
       : Event(linear::EventLoopImpl::TIMER), timer(t) {}
     linear::weak_ptr<linear::TimerImpl> timer;
   };
+  struct TimerWheelEvent : public Event {
+    TimerWheelEvent(const linear::shared_ptr<linear::TimerWheel>& w)
+      : Event(linear::EventLoopImpl::TIMER_WHEEL), wheel(w) {}
+    linear::weak_ptr<linear::TimerWheel> wheel;
+  };
 
  public:
   EventLoopImpl();
@@ -56,15 +63,22 @@ class EventLoopImpl {
   static void OnClose(tv_handle_t* handle);
   static void OnRead(tv_stream_t* handle, ssize_t nread, const tv_buf_t* buf);
   static void OnWrite(tv_write_t* req, int status);
+  static void OnBatchWrite(tv_write_t* req, int status);
+  static void OnSharedWrite(tv_write_t* req, int status);
   static void OnTimer(tv_timer_t* tv_timer);
+  static void OnTimerWheel(tv_timer_t* tv_timer);
 
   static void OnConnectTimeout(void* args);
+  static void OnFlush(void* args);
+  static void OnReconnect(void* args);
   static void OnRequestTimeout(void* args);
 
   tv_loop_t* GetHandle() const;
+  const linear::shared_ptr<linear::TimerWheel>& GetTimerWheel() const;
 
  private:
   tv_loop_t* handle_;
+  linear::shared_ptr<linear::TimerWheel> timer_wheel_;
 };
 
 }  // namespace linear
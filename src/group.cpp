@@ -1,80 +1,182 @@
+#include <stdint.h>
+
+#include <algorithm>
 #include <map>
 
 #include "linear/mutex.h"
 #include "linear/log.h"
 #include "linear/group.h"
 
+#include "atomic_ops.h"
+#include "unordered_map_inc.h"
+
 using namespace linear::log;
 
 namespace linear {
 
 namespace group {
 
+// Groups are spread over shards by name and the reverse index
+// (socket id -> names of its groups) over shards by socket id, so that
+// leaving touches only the groups a socket is in.
+// The members of a group are handed out as its snapshot as they are.
+// Join and Leave update them in place while no reader holds them, and
+// otherwise replace them with a copy, so that readers never copy and
+// a burst of joins between two broadcasts costs at most one copy.
+// Lock order: a group shard, then a member shard.
 class Pool {
  public:
+  static const size_t SHARDS = 16; // power of 2
+
   static Pool& GetInstance() {
     static Pool pool;
     return pool;
   }
-  Pool() : mutex_() {}
+  Pool() : empty_(new std::set<linear::Socket>()) {}
   ~Pool() {}
   std::vector<std::string> Names() {
     std::vector<std::string> keys;
-    lock_guard<linear::mutex> lock(mutex_);
-
-    std::map<std::string, std::set<linear::Socket> >::iterator it = pool_.begin();
-    while(it != pool_.end()) {
-      keys.push_back(it->first);
-      ++it;
+    for (size_t i = 0; i < SHARDS; i++) {
+      lock_guard<linear::mutex> lock(groups_[i].mutex);
+      for (Groups::iterator it = groups_[i].groups.begin(); it != groups_[i].groups.end(); it++) {
+        keys.push_back(it->first);
+      }
     }
+    std::sort(keys.begin(), keys.end());
     return keys;
   }
+  Group::Snapshot GetSnapshot(const std::string& name) {
+    GroupShard& shard = GetGroupShard(name);
+    lock_guard<linear::mutex> lock(shard.mutex);
+    Groups::iterator it = shard.groups.find(name);
+    if (it == shard.groups.end() || !it->second.members || it->second.members->empty()) {
+      return empty_;
+    }
+    return it->second.members;
+  }
   std::set<linear::Socket> Get(const std::string& name) {
-    lock_guard<linear::mutex> lock(mutex_);
-    std::map<std::string, std::set<linear::Socket> >::iterator it = pool_.find(name);
-    if (it != pool_.end()) {
-      return it->second;
-    } else {
+    GroupShard& shard = GetGroupShard(name);
+    lock_guard<linear::mutex> lock(shard.mutex);
+    Groups::iterator it = shard.groups.find(name);
+    if (it == shard.groups.end() || !it->second.members) {
       return std::set<linear::Socket>();
     }
+    return *it->second.members;
   }
   void Join(const std::string& name, const linear::Socket& socket) {
-    lock_guard<linear::mutex> lock(mutex_);
     LINEAR_LOG(LOG_DEBUG, "join socket(id = %d) into group_name = \"%s\"",
                socket.GetId(), name.c_str());
-    pool_[name].insert(socket);
+    GroupShard& shard = GetGroupShard(name);
+    lock_guard<linear::mutex> lock(shard.mutex);
+    Entry& entry = shard.groups[name];
+    if (!entry.members || entry.members->count(socket) == 0) {
+      GetWritable(&entry)->insert(socket);
+    }
+    MemberShard& member_shard = GetMemberShard(socket.GetId());
+    lock_guard<linear::mutex> member_lock(member_shard.mutex);
+    member_shard.members[socket.GetId()].insert(name);
   }
   void Leave(const std::string& name, const linear::Socket& socket) {
-    lock_guard<linear::mutex> lock(mutex_);
     LINEAR_LOG(LOG_DEBUG, "leave socket(id = %d) from group_name = \"%s\"",
                socket.GetId(), name.c_str());
-    pool_[name].erase(socket);
+    GroupShard& shard = GetGroupShard(name);
+    lock_guard<linear::mutex> lock(shard.mutex);
+    Groups::iterator it = shard.groups.find(name);
+    if (it != shard.groups.end()) {
+      Erase(it, socket);
+    }
+    MemberShard& member_shard = GetMemberShard(socket.GetId());
+    lock_guard<linear::mutex> member_lock(member_shard.mutex);
+    Members::iterator member_it = member_shard.members.find(socket.GetId());
+    if (member_it != member_shard.members.end()) {
+      member_it->second.erase(name);
+      if (member_it->second.empty()) {
+        member_shard.members.erase(member_it);
+      }
+    }
   }
   void Leave(const linear::Socket& socket) {
-    lock_guard<linear::mutex> lock(mutex_);
-    std::map<std::string, std::set<linear::Socket> >::iterator pool_it = pool_.begin();
-    while (pool_it != pool_.end()) {
-      std::set<linear::Socket>& sockets = (*pool_it).second;
-      std::set<linear::Socket>::iterator socket_it = sockets.begin();
-      while (socket_it != sockets.end()) {
-        if (socket.GetId() == (*socket_it).GetId()) {
-          LINEAR_LOG(LOG_DEBUG, "leave socket(id = %d) from group_name = \"%s\"",
-                     socket.GetId(), (*pool_it).first.c_str());
-          sockets.erase(*socket_it);
-          break;
-        } else {
-          socket_it++;
-        }
+    std::set<std::string> names;
+    {
+      MemberShard& member_shard = GetMemberShard(socket.GetId());
+      lock_guard<linear::mutex> member_lock(member_shard.mutex);
+      Members::iterator member_it = member_shard.members.find(socket.GetId());
+      if (member_it == member_shard.members.end()) {
+        return;
+      }
+      names.swap(member_it->second);
+      member_shard.members.erase(member_it);
+    }
+    for (std::set<std::string>::iterator it = names.begin(); it != names.end(); it++) {
+      LINEAR_LOG(LOG_DEBUG, "leave socket(id = %d) from group_name = \"%s\"",
+                 socket.GetId(), it->c_str());
+      GroupShard& shard = GetGroupShard(*it);
+      lock_guard<linear::mutex> lock(shard.mutex);
+      Groups::iterator group_it = shard.groups.find(*it);
+      if (group_it != shard.groups.end()) {
+        Erase(group_it, socket);
       }
-      pool_it++;
     }
   }
 
  private:
+  struct Entry {
+    // shared with the readers of its snapshot, use GetWritable to modify
+    linear::shared_ptr<std::set<linear::Socket> > members;
+  };
+  typedef std::map<std::string, Entry> Groups;
+  typedef linear::unordered_map<int, std::set<std::string> > Members;
+
+  struct GroupShard {
+    linear::mutex mutex;
+    Groups groups;
+  };
+  struct MemberShard {
+    linear::mutex mutex;
+    Members members;
+  };
+
+  // FNV-1a
+  static size_t Hash(const std::string& name) {
+    uint32_t hash = 2166136261U;
+    for (std::string::const_iterator it = name.begin(); it != name.end(); it++) {
+      hash ^= static_cast<uint8_t>(*it);
+      hash *= 16777619U;
+    }
+    return hash;
+  }
+  // must be called under the lock of the group shard,
+  // which readers take to share the members
+  static std::set<linear::Socket>* GetWritable(Entry* entry) {
+    if (!entry->members) {
+      entry->members.reset(new std::set<linear::Socket>());
+    } else if (entry->members.use_count() > 1) {
+      entry->members.reset(new std::set<linear::Socket>(*entry->members));
+    } else {
+      // the last reader may have just released them on another thread
+      linear::atomic::FenceSeqCst();
+    }
+    return entry->members.get();
+  }
+  // must be called under the lock of the group shard
+  static void Erase(Groups::iterator it, const linear::Socket& socket) {
+    Entry& entry = it->second;
+    if (entry.members && entry.members->count(socket) > 0) {
+      GetWritable(&entry)->erase(socket);
+    }
+  }
+  GroupShard& GetGroupShard(const std::string& name) {
+    return groups_[Hash(name) & (SHARDS - 1)];
+  }
+  MemberShard& GetMemberShard(int id) {
+    return members_[static_cast<size_t>(id) & (SHARDS - 1)];
+  }
+
   Pool(const Pool& pool);
-  Pool& operator=(const Group& pool);
-  std::map<std::string, std::set<linear::Socket> >pool_;
-  linear::mutex mutex_;
+  Pool& operator=(const Pool& pool);
+  GroupShard groups_[SHARDS];
+  MemberShard members_[SHARDS];
+  const Group::Snapshot empty_;
 };
 
 } // namespace group
@@ -89,6 +191,11 @@ std::set<linear::Socket> Group::Get(const std::string& name) {
   return pool.Get(name);
 }
 
+Group::Snapshot Group::GetSnapshot(const std::string& name) {
+  group::Pool& pool = group::Pool::GetInstance();
+  return pool.GetSnapshot(name);
+}
+
 void Group::Join(const std::string& name, const linear::Socket& socket) {
   group::Pool& pool = group::Pool::GetInstance();
   return pool.Join(name, socket);
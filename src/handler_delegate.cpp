@@ -6,9 +6,12 @@
 # include <openssl/crypto.h>
 #endif
 
+#include <typeinfo>
+
 #include "linear/version.h"
 
 #include "handler_delegate.h"
+#include "worker_pool_impl.h"
 
 using namespace linear::log;
 
@@ -17,7 +20,8 @@ namespace linear {
 HandlerDelegate::HandlerDelegate(const weak_ptr<Handler>& handler,
                                  const EventLoop& loop,
                                  bool show_ssl_version)
-  : loop_(loop.GetImpl()), handler_(handler) {
+  : loop_(loop.GetImpl()), handler_(handler), stats_(new StatsCounters()),
+    latencies_(new LatencyRecorder()) {
 
 #ifndef _WIN32
   signal(SIGPIPE, SIG_IGN);
@@ -55,9 +59,9 @@ void HandlerDelegate::Release(const shared_ptr<SocketImpl>& socket) {
   return pool_.Remove(socket);
 }
 
-void HandlerDelegate::OnConnect(const shared_ptr<SocketImpl>& socket) {
+static void CallOnConnect(const weak_ptr<Handler>& weak_handler, const shared_ptr<SocketImpl>& socket) {
   try {
-    if (shared_ptr<Handler> handler = handler_.lock()) {
+    if (shared_ptr<Handler> handler = weak_handler.lock()) {
       handler->OnConnect(Socket(socket));
     }
   } catch(...) {
@@ -65,9 +69,10 @@ void HandlerDelegate::OnConnect(const shared_ptr<SocketImpl>& socket) {
   }
 }
 
-void HandlerDelegate::OnDisconnect(const shared_ptr<SocketImpl>& socket, const Error& error) {
+static void CallOnDisconnect(const weak_ptr<Handler>& weak_handler, const shared_ptr<SocketImpl>& socket,
+                             const Error& error) {
   try {
-    if (shared_ptr<Handler> handler = handler_.lock()) {
+    if (shared_ptr<Handler> handler = weak_handler.lock()) {
       handler->OnDisconnect(Socket(socket), error);
     }
   } catch(...) {
@@ -75,9 +80,11 @@ void HandlerDelegate::OnDisconnect(const shared_ptr<SocketImpl>& socket, const E
   }
 }
 
-void HandlerDelegate::OnMessage(const shared_ptr<SocketImpl>& socket, const Message& message) {
+// latencies is given for requests while latency stats are enabled
+static void CallOnMessage(const weak_ptr<Handler>& weak_handler, const shared_ptr<SocketImpl>& socket,
+                          const Message& message, LatencyRecorder* latencies) {
   if (message.type == RESPONSE) {
-    Response response = message.as<Response>();
+    const Response& response = static_cast<const Response&>(message);
     const Request& request = response.request;
     if (request.HasResponseCallback()) {
       try {
@@ -87,7 +94,7 @@ void HandlerDelegate::OnMessage(const shared_ptr<SocketImpl>& socket, const Mess
       }
     } else {
       try {
-        if (shared_ptr<Handler> handler = handler_.lock()) {
+        if (shared_ptr<Handler> handler = weak_handler.lock()) {
           handler->OnMessage(Socket(socket), message);
         }
       } catch(...) {
@@ -96,8 +103,12 @@ void HandlerDelegate::OnMessage(const shared_ptr<SocketImpl>& socket, const Mess
     }
   } else {
     try {
-      if (shared_ptr<Handler> handler = handler_.lock()) {
+      if (shared_ptr<Handler> handler = weak_handler.lock()) {
+        uint64_t start = (latencies != NULL) ? uv_hrtime() : 0;
         handler->OnMessage(Socket(socket), message);
+        if (latencies != NULL) {
+          latencies->RecordServiceTime(static_cast<const Request&>(message).method, (uv_hrtime() - start) / 1000);
+        }
       }
     } catch(...) {
       LINEAR_LOG(LOG_WARN, "something wrong at Handler::OnMessage");
@@ -105,9 +116,10 @@ void HandlerDelegate::OnMessage(const shared_ptr<SocketImpl>& socket, const Mess
   }
 }
 
-void HandlerDelegate::OnError(const shared_ptr<SocketImpl>& socket, const Message& message, const Error& error) {
+static void CallOnError(const weak_ptr<Handler>& weak_handler, const shared_ptr<SocketImpl>& socket,
+                        const Message& message, const Error& error) {
   if (message.type == REQUEST) {
-    Request request = message.as<Request>();
+    const Request& request = static_cast<const Request&>(message);
     if (request.HasErrorCallback()) {
       try {
         request.FireErrorCallback(Socket(socket), request, error);
@@ -116,7 +128,7 @@ void HandlerDelegate::OnError(const shared_ptr<SocketImpl>& socket, const Messag
       }
     } else {
       try {
-        if (shared_ptr<Handler> handler = handler_.lock()) {
+        if (shared_ptr<Handler> handler = weak_handler.lock()) {
           handler->OnError(Socket(socket), message, error);
         }
       } catch(...) {
@@ -125,7 +137,7 @@ void HandlerDelegate::OnError(const shared_ptr<SocketImpl>& socket, const Messag
     }
   } else {
     try {
-      if (shared_ptr<Handler> handler = handler_.lock()) {
+      if (shared_ptr<Handler> handler = weak_handler.lock()) {
         handler->OnError(Socket(socket), message, error);
       }
     } catch(...) {
@@ -134,4 +146,149 @@ void HandlerDelegate::OnError(const shared_ptr<SocketImpl>& socket, const Messag
   }
 }
 
+
+static Message* CopyMessage(const Message& message) {
+  switch(message.type) {
+  case REQUEST:
+    return new Request(static_cast<const Request&>(message));
+  case RESPONSE:
+    return new Response(static_cast<const Response&>(message));
+  case NOTIFY:
+    return new Notify(static_cast<const Notify&>(message));
+  default:
+    throw std::bad_typeid();
+  }
+}
+
+// callbacks handed over to a WorkerPool
+class ConnectTask : public WorkerPoolImpl::Task {
+ public:
+  ConnectTask(const weak_ptr<Handler>& handler, const shared_ptr<SocketImpl>& socket)
+    : handler_(handler), socket_(socket) {}
+  void Run() {
+    CallOnConnect(handler_, socket_);
+  }
+ private:
+  weak_ptr<Handler> handler_;
+  shared_ptr<SocketImpl> socket_;
+};
+
+class DisconnectTask : public WorkerPoolImpl::Task {
+ public:
+  DisconnectTask(const weak_ptr<Handler>& handler, const shared_ptr<SocketImpl>& socket, const Error& error)
+    : handler_(handler), socket_(socket), error_(error) {}
+  void Run() {
+    CallOnDisconnect(handler_, socket_, error_);
+  }
+ private:
+  weak_ptr<Handler> handler_;
+  shared_ptr<SocketImpl> socket_;
+  Error error_;
+};
+
+class MessageTask : public WorkerPoolImpl::Task {
+ public:
+  MessageTask(const weak_ptr<Handler>& handler, const shared_ptr<SocketImpl>& socket, const Message& message,
+              const shared_ptr<LatencyRecorder>& latencies)
+    : handler_(handler), socket_(socket), message_(CopyMessage(message)), latencies_(latencies) {}
+  ~MessageTask() {
+    delete message_;
+  }
+  void Run() {
+    CallOnMessage(handler_, socket_, *message_, latencies_.get());
+  }
+ private:
+  weak_ptr<Handler> handler_;
+  shared_ptr<SocketImpl> socket_;
+  Message* message_;
+  shared_ptr<LatencyRecorder> latencies_;
+};
+
+class ErrorTask : public WorkerPoolImpl::Task {
+ public:
+  ErrorTask(const weak_ptr<Handler>& handler, const shared_ptr<SocketImpl>& socket,
+            const Message& message, const Error& error)
+    : handler_(handler), socket_(socket), message_(CopyMessage(message)), error_(error) {}
+  ~ErrorTask() {
+    delete message_;
+  }
+  void Run() {
+    CallOnError(handler_, socket_, *message_, error_);
+  }
+ private:
+  weak_ptr<Handler> handler_;
+  shared_ptr<SocketImpl> socket_;
+  Message* message_;
+  Error error_;
+};
+
+void HandlerDelegate::SetWorkerPool(const shared_ptr<WorkerPoolImpl>& workers) {
+  lock_guard<mutex> lock(workers_mutex_);
+  workers_ = workers;
+}
+
+shared_ptr<WorkerPoolImpl> HandlerDelegate::GetWorkerPool() {
+  lock_guard<mutex> lock(workers_mutex_);
+  return workers_;
+}
+
+// Every callback of a socket goes through the same strand of the pool,
+// so OnDisconnect never overtakes the messages received before it.
+void HandlerDelegate::OnConnect(const shared_ptr<SocketImpl>& socket) {
+  if (shared_ptr<WorkerPoolImpl> workers = GetWorkerPool()) {
+    try {
+      workers->Post(socket->GetId(), new ConnectTask(handler_, socket), false);
+      return;
+    } catch(...) {
+      LINEAR_LOG(LOG_ERR, "no memory");
+    }
+  }
+  CallOnConnect(handler_, socket);
+}
+
+void HandlerDelegate::OnDisconnect(const shared_ptr<SocketImpl>& socket, const Error& error) {
+  if (shared_ptr<WorkerPoolImpl> workers = GetWorkerPool()) {
+    try {
+      workers->Post(socket->GetId(), new DisconnectTask(handler_, socket, error), false);
+      return;
+    } catch(...) {
+      LINEAR_LOG(LOG_ERR, "no memory");
+    }
+  }
+  CallOnDisconnect(handler_, socket, error);
+}
+
+void HandlerDelegate::OnMessage(const shared_ptr<SocketImpl>& socket, const Message& message) {
+  bool timed = (message.type == REQUEST && latencies_->IsEnabled());
+  if (shared_ptr<WorkerPoolImpl> workers = GetWorkerPool()) {
+    try {
+      // a dropped request times out on the peer, but nothing would ever report
+      // a dropped response: its request is already taken out of the timers
+      Error err = workers->Post(socket->GetId(),
+                                new MessageTask(handler_, socket, message, timed ? latencies_ : shared_ptr<LatencyRecorder>()),
+                                message.type != RESPONSE);
+      if (err == Error(LNR_ENOBUFS)) {
+        LINEAR_LOG(LOG_WARN, "drop message, worker queue is full(id = %d): type = %d",
+                   socket->GetId(), message.type);
+      }
+      return;
+    } catch(...) {
+      LINEAR_LOG(LOG_ERR, "no memory");
+    }
+  }
+  CallOnMessage(handler_, socket, message, timed ? latencies_.get() : NULL);
+}
+
+void HandlerDelegate::OnError(const shared_ptr<SocketImpl>& socket, const Message& message, const Error& error) {
+  if (shared_ptr<WorkerPoolImpl> workers = GetWorkerPool()) {
+    try {
+      workers->Post(socket->GetId(), new ErrorTask(handler_, socket, message, error), false);
+      return;
+    } catch(...) {
+      LINEAR_LOG(LOG_ERR, "no memory");
+    }
+  }
+  CallOnError(handler_, socket, message, error);
+}
+
 } // namespace linear
@@ -5,10 +5,14 @@
 #include "linear/handler.h"
 
 #include "event_loop_impl.h"
+#include "latency_stats.h"
 #include "socket_pool.h"
+#include "stats_counters.h"
 
 namespace linear {
 
+class WorkerPoolImpl;
+
 class HandlerDelegate {
  public:
   HandlerDelegate(const linear::weak_ptr<linear::Handler>& handler,
@@ -17,6 +21,10 @@ class HandlerDelegate {
   virtual ~HandlerDelegate();
 
   void SetMaxLimit(size_t max_limit);
+  void SetWorkerPool(const linear::shared_ptr<linear::WorkerPoolImpl>& workers);
+  // summed over the sockets accepted by a server
+  inline const linear::shared_ptr<linear::StatsCounters>& GetStatsCounters() { return stats_; }
+  inline const linear::shared_ptr<linear::LatencyRecorder>& GetLatencyRecorder() { return latencies_; }
   virtual linear::Error Retain(const linear::shared_ptr<linear::SocketImpl>& socket);
   virtual void Release(const linear::shared_ptr<linear::SocketImpl>& socket);
 
@@ -30,9 +38,17 @@ class HandlerDelegate {
                        const linear::Error& error);
 
  protected:
+  linear::shared_ptr<linear::WorkerPoolImpl> GetWorkerPool();
+
   linear::shared_ptr<linear::EventLoopImpl> loop_;
   linear::weak_ptr<linear::Handler> handler_;
   linear::SocketPool pool_;
+  linear::shared_ptr<linear::StatsCounters> stats_;
+  linear::shared_ptr<linear::LatencyRecorder> latencies_;
+
+ private:
+  linear::mutex workers_mutex_;
+  linear::shared_ptr<linear::WorkerPoolImpl> workers_;
 };
 
 }  // namespace linear
@@ -0,0 +1,189 @@
+#include <vector>
+
+#include "latency_stats.h"
+
+namespace linear {
+
+static const uint64_t NO_MINIMUM = ~static_cast<uint64_t>(0);
+
+LatencyHistogram::LatencyHistogram() : sum_(0), minimum_(NO_MINIMUM), maximum_(0) {
+  for (size_t i = 0; i < BUCKETS; i++) {
+    buckets_[i] = 0;
+  }
+}
+
+static int MostSignificantBit(uint64_t v) {
+#if defined(__GNUC__)
+  return 63 - __builtin_clzll(v);
+#else
+  int msb = 0;
+  while (v >>= 1) {
+    msb++;
+  }
+  return msb;
+#endif
+}
+
+size_t LatencyHistogram::Index(uint64_t usec) {
+  if (usec < 2 * SUB_BUCKETS) {
+    return static_cast<size_t>(usec);
+  }
+  int shift = MostSignificantBit(usec) - SUB_BITS;
+  if (shift > MAX_SHIFT) {
+    return BUCKETS - 1;
+  }
+  return (shift + 1) * SUB_BUCKETS + static_cast<size_t>((usec >> shift) - SUB_BUCKETS);
+}
+
+uint64_t LatencyHistogram::UpperBound(size_t index) {
+  if (index < 2 * SUB_BUCKETS) {
+    return index;
+  }
+  int shift = static_cast<int>(index / SUB_BUCKETS) - 1;
+  uint64_t lower = static_cast<uint64_t>(SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+  return lower + (static_cast<uint64_t>(1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t usec) {
+  atomic::FetchAddRelaxed(&buckets_[Index(usec)], static_cast<size_t>(1));
+#if defined(LINEAR_ATOMIC_64)
+  atomic::FetchAddRelaxed(&sum_, usec);
+  uint64_t minimum = atomic::LoadRelaxed(&minimum_);
+  while (usec < minimum && !atomic::CompareExchange(&minimum_, &minimum, usec)) {}
+  uint64_t maximum = atomic::LoadRelaxed(&maximum_);
+  while (usec > maximum && !atomic::CompareExchange(&maximum_, &maximum, usec)) {}
+#else
+  lock_guard<mutex> lock(mutex_);
+  sum_ += usec;
+  minimum_ = (usec < minimum_) ? usec : minimum_;
+  maximum_ = (usec > maximum_) ? usec : maximum_;
+#endif
+}
+
+void LatencyHistogram::Snapshot(Latency* latency, bool reset) {
+  std::vector<uint64_t> counts(BUCKETS);
+  uint64_t count = 0;
+  for (size_t i = 0; i < BUCKETS; i++) {
+    counts[i] = reset ? atomic::Exchange(&buckets_[i], static_cast<size_t>(0)) : atomic::LoadRelaxed(&buckets_[i]);
+    count += counts[i];
+  }
+#if defined(LINEAR_ATOMIC_64)
+  uint64_t sum = reset ? atomic::Exchange(&sum_, static_cast<uint64_t>(0)) : atomic::LoadRelaxed(&sum_);
+  uint64_t minimum = reset ? atomic::Exchange(&minimum_, NO_MINIMUM) : atomic::LoadRelaxed(&minimum_);
+  uint64_t maximum = reset ? atomic::Exchange(&maximum_, static_cast<uint64_t>(0)) : atomic::LoadRelaxed(&maximum_);
+#else
+  unique_lock<mutex> lock(mutex_);
+  uint64_t sum = sum_;
+  uint64_t minimum = minimum_;
+  uint64_t maximum = maximum_;
+  if (reset) {
+    sum_ = 0;
+    minimum_ = NO_MINIMUM;
+    maximum_ = 0;
+  }
+  lock.unlock();
+#endif
+  *latency = Latency();
+  if (count == 0) {
+    return;
+  }
+  latency->count = count;
+  latency->mean = sum / count;
+  // samples recorded while resetting may move minimum and maximum to the next snapshot
+  bool bounded = (minimum <= maximum);
+  latency->minimum = bounded ? minimum : 0;
+  latency->maximum = bounded ? maximum : 0;
+
+  static const uint64_t permilles[] = {500, 900, 990, 999};
+  uint64_t* percentiles[] = {&latency->p50, &latency->p90, &latency->p99, &latency->p999};
+  size_t index = 0;
+  uint64_t seen = counts[0];
+  for (size_t i = 0; i < sizeof(permilles) / sizeof(permilles[0]); i++) {
+    uint64_t rank = (count * permilles[i] + 999) / 1000; // 1-origin
+    while (seen < rank && index < BUCKETS - 1) {
+      seen += counts[++index];
+    }
+    uint64_t value = UpperBound(index);
+    if (bounded) {
+      value = (value > maximum) ? maximum : (value < minimum) ? minimum : value;
+    }
+    *percentiles[i] = value;
+  }
+}
+
+LatencyRecorder::~LatencyRecorder() {
+  for (int i = 0; i < SHARDS; i++) {
+    for (unordered_map<std::string, Histograms*>::iterator it = shards_[i].methods.begin();
+         it != shards_[i].methods.end(); it++) {
+      delete it->second;
+    }
+  }
+}
+
+void LatencyRecorder::SetEnabled(bool enable) {
+  atomic::StoreRelaxed(&enabled_, static_cast<size_t>(enable ? 1 : 0));
+}
+
+bool LatencyRecorder::IsEnabled() const {
+  return (atomic::LoadRelaxed(&enabled_) != 0);
+}
+
+void LatencyRecorder::RecordServiceTime(const std::string& method, uint64_t usec) {
+  if (Histograms* histograms = _Get(method)) {
+    histograms->service_time.Record(usec);
+  }
+}
+
+void LatencyRecorder::RecordRoundTrip(const std::string& method, uint64_t usec) {
+  if (Histograms* histograms = _Get(method)) {
+    histograms->round_trip.Record(usec);
+  }
+}
+
+void LatencyRecorder::Snapshot(MethodLatencies* latencies, bool reset) {
+  // histograms live as long as the recorder, so they are read without the locks
+  std::vector<std::pair<std::string, Histograms*> > methods;
+  for (int i = 0; i < SHARDS; i++) {
+    lock_guard<mutex> lock(shards_[i].mutex);
+    methods.insert(methods.end(), shards_[i].methods.begin(), shards_[i].methods.end());
+  }
+  methods.push_back(std::make_pair(std::string(), &others_));
+  latencies->clear();
+  for (std::vector<std::pair<std::string, Histograms*> >::iterator it = methods.begin(); it != methods.end(); it++) {
+    MethodLatency latency;
+    it->second->service_time.Snapshot(&latency.service_time, reset);
+    it->second->round_trip.Snapshot(&latency.round_trip, reset);
+    if (it->second != &others_ || latency.service_time.count > 0 || latency.round_trip.count > 0) {
+      (*latencies)[it->first] = latency;
+    }
+  }
+}
+
+LatencyRecorder::Histograms* LatencyRecorder::_Get(const std::string& method) {
+  uint32_t hash = 2166136261U; // FNV-1a
+  for (std::string::const_iterator it = method.begin(); it != method.end(); it++) {
+    hash = (hash ^ static_cast<unsigned char>(*it)) * 16777619U;
+  }
+  Shard& shard = shards_[hash & (SHARDS - 1)];
+  lock_guard<mutex> lock(shard.mutex);
+  unordered_map<std::string, Histograms*>::iterator found = shard.methods.find(method);
+  if (found != shard.methods.end()) {
+    return found->second;
+  }
+  if (atomic::FetchAdd(&methods_, static_cast<size_t>(1)) >= MAX_METHODS) {
+    atomic::FetchAdd(&methods_, static_cast<size_t>(-1));
+    return &others_;
+  }
+  Histograms* histograms = NULL;
+  try {
+    histograms = new Histograms();
+    shard.methods.insert(std::make_pair(method, histograms));
+  } catch(...) {
+    delete histograms;
+    atomic::FetchAdd(&methods_, static_cast<size_t>(-1));
+    return NULL;
+  }
+  return histograms;
+}
+
+}  // namespace linear
@@ -0,0 +1,98 @@
+#ifndef LINEAR_LATENCY_STATS_H_
+#define LINEAR_LATENCY_STATS_H_
+
+#include <string>
+
+#include "linear/mutex.h"
+#include "linear/stats.h"
+
+#include "atomic_ops.h"
+
+#include "unordered_map_inc.h"
+
+namespace linear {
+
+// Log-linear histogram of latencies in usec, like HdrHistogram:
+// values below 2 * SUB_BUCKETS have a bucket each, and every power of 2 above
+// is split into SUB_BUCKETS buckets, which keeps the relative error under 1/SUB_BUCKETS.
+// Recording is a few relaxed atomic additions, and a snapshot may take the
+// buckets away (reset) while others keep recording: no sample is lost or counted twice.
+// Without word-sized 64bit integers, the sum and extremes are kept under a mutex instead.
+class LatencyHistogram {
+ public:
+  static const int SUB_BITS = 5;
+  static const size_t SUB_BUCKETS = 1 << SUB_BITS;
+  static const int MAX_SHIFT = 31; // up to 2^37 usec (38 hours), larger values fall into the last bucket
+  static const size_t BUCKETS = (MAX_SHIFT + 2) * SUB_BUCKETS;
+
+  LatencyHistogram();
+  ~LatencyHistogram() {}
+
+  void Record(uint64_t usec);
+  void Snapshot(linear::Latency* latency, bool reset);
+
+  static size_t Index(uint64_t usec);
+  // the largest value which falls into the bucket
+  static uint64_t UpperBound(size_t index);
+
+ private:
+  LatencyHistogram(const LatencyHistogram&);
+  LatencyHistogram& operator=(const LatencyHistogram&);
+
+  volatile size_t buckets_[BUCKETS];
+#if defined(LINEAR_ATOMIC_64)
+  volatile uint64_t sum_;
+  volatile uint64_t minimum_;
+  volatile uint64_t maximum_;
+#else
+  linear::mutex mutex_;
+  uint64_t sum_;
+  uint64_t minimum_;
+  uint64_t maximum_;
+#endif
+};
+
+// Latencies of requests per method.
+// Looking up a method takes the lock of one of the shards;
+// the histograms themselves are recorded without any lock.
+class LatencyRecorder {
+ public:
+  static const int SHARDS = 16; // power of 2
+  // methods beyond the limit are summed under an empty name,
+  // so that peers sending random method names cannot exhaust memory
+  static const size_t MAX_METHODS = 256;
+
+  LatencyRecorder() : enabled_(0), methods_(0) {}
+  ~LatencyRecorder();
+
+  void SetEnabled(bool enable);
+  bool IsEnabled() const;
+  void RecordServiceTime(const std::string& method, uint64_t usec);
+  void RecordRoundTrip(const std::string& method, uint64_t usec);
+  void Snapshot(linear::MethodLatencies* latencies, bool reset);
+
+ private:
+  struct Histograms {
+    linear::LatencyHistogram service_time;
+    linear::LatencyHistogram round_trip;
+  };
+  struct Shard {
+    linear::mutex mutex;
+    linear::unordered_map<std::string, Histograms*> methods;
+  };
+
+  // returns NULL when no memory
+  Histograms* _Get(const std::string& method);
+
+  LatencyRecorder(const LatencyRecorder&);
+  LatencyRecorder& operator=(const LatencyRecorder&);
+
+  Shard shards_[SHARDS];
+  Histograms others_;
+  volatile size_t enabled_;
+  volatile size_t methods_;
+};
+
+}  // namespace linear
+
+#endif  // LINEAR_LATENCY_STATS_H_
@@ -1,6 +1,7 @@
 #include <stdarg.h>
 #include <time.h>
 
+#include "log_async.h"
 #include "log_stderr.h"
 #include "log_function.h"
 
@@ -20,6 +21,7 @@ static Level g_level = LOG_OFF;
 static bool g_log_stderr = false;
 static bool g_log_file = false;
 static bool g_log_function = false;
+static bool g_log_async = false;
 
 static LogStderr& GetLogStderr() {
   static LogStderr s_stderr;
@@ -33,6 +35,25 @@ static LogFunction& GetLogFunction() {
   static LogFunction s_function;
   return s_function;
 }
+static LogAsync& GetLogAsync() {
+  static LogAsync s_async;
+  return s_async;
+}
+
+static void Dispatch(const LogAsync::Record& record, bool last) {
+  if (g_log_stderr) {
+    GetLogStderr().Write(record.debug, record.level, record.file, record.line, record.func,
+                         record.message.c_str(), record.time, last);
+  }
+  if (g_log_file) {
+    GetLogFile().Write(record.debug, record.level, record.file, record.line, record.func,
+                       record.message.c_str(), record.time, last);
+  }
+  if (g_log_function) {
+    GetLogFunction().Write(record.debug, record.level, record.file, record.line, record.func,
+                           record.message.c_str(), record.time, last);
+  }
+}
 
 /* functions */
 Level GetLevel() {
@@ -43,6 +64,10 @@ void SetLevel(Level level) {
   g_level = level;
 }
 
+Level GetCompileLevel() {
+  return static_cast<Level>(LINEAR_LOG_COMPILE_LEVEL);
+}
+
 bool EnableStderr() {
   g_log_stderr = GetLogStderr().Enable();
   return g_log_stderr;
@@ -79,6 +104,26 @@ void DisableCallback() {
   }
 }
 
+bool EnableAsync(size_t capacity, bool block) {
+  // the writers must outlive the thread writing to them at exit
+  GetLogStderr();
+  GetLogFile();
+  GetLogFunction();
+  g_log_async = GetLogAsync().Enable(capacity, block, Dispatch);
+  return g_log_async;
+}
+
+void DisableAsync() {
+  if (g_log_async) {
+    g_log_async = false;
+    GetLogAsync().Disable();
+  }
+}
+
+size_t GetDroppedLogs() {
+  return GetLogAsync().GetDropped();
+}
+
 void Colorize(bool flag) {
   if (g_log_stderr) {
     GetLogStderr().Colorize(flag);
@@ -101,34 +146,48 @@ void Print(bool debug, linear::log::Level level, const char* file, int line, con
 #endif
   va_end(args);
 
+  if (g_log_async && GetLogAsync().Push(debug, level, file, line, func, buffer)) {
+    return;
+  }
+  Log::Time now = Log::Now();
   if (g_log_stderr) {
-    GetLogStderr().Write(debug, level, file, line, func, buffer);
+    GetLogStderr().Write(debug, level, file, line, func, buffer, now);
   }
   if (g_log_file) {
-    GetLogFile().Write(debug, level, file, line, func, buffer);
+    GetLogFile().Write(debug, level, file, line, func, buffer, now);
   }
   if (g_log_function) {
-    GetLogFunction().Write(debug, level, file, line, func, buffer);
+    GetLogFunction().Write(debug, level, file, line, func, buffer, now);
   }
 }
 
 /* Log class methods */
-std::string Log::GetDateTime() {
+Log::Time Log::Now() {
+  Time now;
+#ifdef _WIN32
+  GetLocalTime(&now);
+#else
+  if (gettimeofday(&now, 0) != 0) {
+    now.tv_sec = 0;
+    now.tv_usec = 0;
+  }
+#endif
+  return now;
+}
+
+std::string Log::GetDateTime(const Time& time) {
   char datetime_str[32];
 
 #ifdef _WIN32
-  SYSTEMTIME st;
-  GetLocalTime(&st);
   _snprintf_s(datetime_str, sizeof(datetime_str), _TRUNCATE,
               "%d-%02d-%02d %02d:%02d:%02d.%03d",
-              st.wYear, st.wMonth, st.wDay,
-              st.wHour, st.wMinute, st.wSecond, st.wMilliseconds);
+              time.wYear, time.wMonth, time.wDay,
+              time.wHour, time.wMinute, time.wSecond, time.wMilliseconds);
 #else
   struct tm ts;
-  struct timeval now;
   struct tm* ret = NULL;
-  if (gettimeofday(&now, 0) == 0) {
-    ret = localtime_r(&now.tv_sec, &ts);
+  if (time.tv_sec != 0) {
+    ret = localtime_r(&time.tv_sec, &ts);
   }
   if (ret == NULL) {
     snprintf(datetime_str, sizeof(datetime_str), "ERR: fail to get date");
@@ -137,7 +196,7 @@ std::string Log::GetDateTime() {
              "%d-%02d-%02d %02d:%02d:%02d.%03d",
              ts.tm_year + 1900, ts.tm_mon + 1, ts.tm_mday,
              ts.tm_hour, ts.tm_min, ts.tm_sec,
-             static_cast<int>(now.tv_usec / 1000));
+             static_cast<int>(time.tv_usec / 1000));
   }
 #endif
 
@@ -1,6 +1,12 @@
 #ifndef	LINEAR_LOG_INTERNAL_H_
 #define	LINEAR_LOG_INTERNAL_H_
 
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <sys/time.h>
+#endif
+
 #include "linear/log.h"
 #include "linear/mutex.h"
 
@@ -12,7 +18,16 @@ namespace log {
 
 class Log {
  public:
-  virtual void Write(bool debug, Level level, const char* fname, int line, const char* func, const char* message) = 0;
+#ifdef _WIN32
+  typedef SYSTEMTIME Time;
+#else
+  typedef struct timeval Time;
+#endif
+  static Time Now();
+
+  // flush == false lets a writer of several logs at once flush only after the last one
+  virtual void Write(bool debug, Level level, const char* fname, int line, const char* func, const char* message,
+                     const Time& time, bool flush = true) = 0;
 
  protected:
   Log() {}
@@ -20,7 +35,7 @@ class Log {
   Log& operator=(const Log& rhs);
   virtual ~Log() {}
   virtual bool Available() = 0;
-  std::string GetDateTime();
+  std::string GetDateTime(const Time& time);
 
   linear::mutex mutex_;
 };
@@ -0,0 +1,202 @@
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <sched.h>
+#endif
+
+#include "atomic_ops.h"
+#include "log_async.h"
+
+namespace linear {
+
+namespace log {
+
+static void YieldThread() {
+#ifdef _WIN32
+  SwitchToThread();
+#else
+  sched_yield();
+#endif
+}
+
+LogAsync::~LogAsync() {
+  Disable();
+}
+
+bool LogAsync::Enable(size_t capacity, bool block, Writer writer) {
+  lock_guard<mutex> enable_lock(enable_mutex_);
+  if (atomic::LoadAcquire(&running_) != 0) {
+    return true;
+  }
+  size_t size = 2;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  try {
+    cells_ = new Cell[size];
+  } catch(...) {
+    return false;
+  }
+  for (size_t i = 0; i < size; i++) {
+    cells_[i].sequence = i;
+  }
+  mask_ = size - 1;
+  enqueue_pos_ = 0;
+  dequeue_pos_ = 0;
+  writer_ = writer;
+  block_ = block;
+  stop_ = false;
+  if (uv_thread_create(&thread_, LogAsync::Run, this)) {
+    delete[] cells_;
+    cells_ = NULL;
+    return false;
+  }
+  atomic::StoreRelease(&running_, static_cast<size_t>(1));
+  return true;
+}
+
+void LogAsync::Disable() {
+  lock_guard<mutex> enable_lock(enable_mutex_);
+  if (atomic::LoadAcquire(&running_) == 0) {
+    return;
+  }
+  atomic::StoreRelease(&running_, static_cast<size_t>(0));
+  atomic::FenceSeqCst();
+  // producers that saw running_ finish pushing; the thread keeps draining meanwhile
+  while (atomic::LoadAcquire(&active_) != 0) {
+    YieldThread();
+  }
+  {
+    lock_guard<mutex> lock(mutex_);
+    stop_ = true;
+    ready_cond_.notify_one();
+  }
+  uv_thread_join(&thread_);
+  delete[] cells_;
+  cells_ = NULL;
+}
+
+bool LogAsync::Push(bool debug, Level level, const char* file, int line, const char* func, const char* message) {
+  atomic::FetchAdd(&active_, static_cast<size_t>(1));
+  atomic::FenceSeqCst();
+  uv_thread_t self = uv_thread_self();
+  if (atomic::LoadAcquire(&running_) == 0 || uv_thread_equal(&self, &thread_)) {
+    atomic::FetchAdd(&active_, static_cast<size_t>(-1));
+    return false;
+  }
+  if (!_TryPush(debug, level, file, line, func, message)) {
+    if (!block_) {
+      atomic::FetchAddRelaxed(&dropped_, static_cast<size_t>(1));
+      atomic::FetchAdd(&active_, static_cast<size_t>(-1));
+      return true;
+    }
+    unique_lock<mutex> lock(mutex_);
+    atomic::FetchAdd(&waiting_, static_cast<size_t>(1));
+    atomic::FenceSeqCst();
+    while (!_TryPush(debug, level, file, line, func, message)) {
+      space_cond_.wait(lock);
+    }
+    atomic::FetchAdd(&waiting_, static_cast<size_t>(-1));
+  }
+  atomic::FenceSeqCst();
+  if (atomic::LoadRelaxed(&sleeping_) != 0) {
+    lock_guard<mutex> lock(mutex_);
+    ready_cond_.notify_one();
+  }
+  atomic::FetchAdd(&active_, static_cast<size_t>(-1));
+  return true;
+}
+
+size_t LogAsync::GetDropped() const {
+  return atomic::LoadRelaxed(&dropped_);
+}
+
+void LogAsync::Run(void* args) {
+  static_cast<LogAsync*>(args)->_Run();
+}
+
+void LogAsync::_Run() {
+  while (true) {
+    if (_Drain() > 0) {
+      atomic::FenceSeqCst();
+      if (atomic::LoadRelaxed(&waiting_) != 0) {
+        lock_guard<mutex> lock(mutex_);
+        space_cond_.notify_all();
+      }
+      continue;
+    }
+    unique_lock<mutex> lock(mutex_);
+    atomic::StoreRelaxed(&sleeping_, static_cast<size_t>(1));
+    atomic::FenceSeqCst();
+    Cell* cell = &cells_[dequeue_pos_ & mask_];
+    if (atomic::LoadAcquire(&cell->sequence) == dequeue_pos_ + 1) {
+      atomic::StoreRelaxed(&sleeping_, static_cast<size_t>(0));
+      continue;
+    }
+    if (stop_) {
+      atomic::StoreRelaxed(&sleeping_, static_cast<size_t>(0));
+      return;
+    }
+    ready_cond_.wait(lock);
+    atomic::StoreRelaxed(&sleeping_, static_cast<size_t>(0));
+  }
+}
+
+bool LogAsync::_TryPush(bool debug, Level level, const char* file, int line, const char* func, const char* message) {
+  size_t pos = atomic::LoadRelaxed(&enqueue_pos_);
+  Cell* cell;
+  while (true) {
+    cell = &cells_[pos & mask_];
+    ptrdiff_t diff = static_cast<ptrdiff_t>(atomic::LoadAcquire(&cell->sequence) - pos);
+    if (diff == 0) {
+      if (atomic::CompareExchange(&enqueue_pos_, &pos, pos + 1)) {
+        break;
+      }
+    } else if (diff < 0) {
+      return false; // full
+    } else {
+      pos = atomic::LoadRelaxed(&enqueue_pos_);
+    }
+  }
+  Record& record = cell->record;
+  record.debug = debug;
+  record.level = level;
+  record.file = file;
+  record.line = line;
+  record.func = func;
+  record.time = Log::Now();
+  try {
+    record.message.assign(message); // reuses the capacity of former logs
+  } catch(...) {
+    record.message.clear();
+  }
+  atomic::StoreRelease(&cell->sequence, pos + 1);
+  return true;
+}
+
+size_t LogAsync::_Drain() {
+  size_t num = 0;
+  Cell* cell = &cells_[dequeue_pos_ & mask_];
+  if (atomic::LoadAcquire(&cell->sequence) != dequeue_pos_ + 1) {
+    return 0;
+  }
+  while (cell != NULL) {
+    num++;
+    Cell* next = NULL;
+    if (num < MAX_BATCH) {
+      next = &cells_[(dequeue_pos_ + 1) & mask_];
+      if (atomic::LoadAcquire(&next->sequence) != dequeue_pos_ + 2) {
+        next = NULL;
+      }
+    }
+    writer_(cell->record, next == NULL);
+    atomic::StoreRelease(&cell->sequence, dequeue_pos_ + mask_ + 1);
+    dequeue_pos_++;
+    cell = next;
+  }
+  return num;
+}
+
+}  // namespace log
+
+}  // namespace linear
@@ -0,0 +1,88 @@
+#ifndef LINEAR_LOG_ASYNC_H_
+#define LINEAR_LOG_ASYNC_H_
+
+#include <vector>
+
+#include "linear/condition_variable.h"
+
+#include "log.h"
+#include "uv.h"
+
+namespace linear {
+
+namespace log {
+
+// Hands logs over to a background thread.
+// Producers push records into a bounded lock-free MPSC ring (Dmitry Vyukov's
+// bounded queue with a sequence number per cell) and take no lock unless the
+// thread sleeps or the ring is full in blocking mode.
+// The thread pops records in batches and passes them to the writer function.
+class LogAsync {
+ public:
+  struct Record {
+    bool debug;
+    Level level;
+    const char* file;
+    int line;
+    const char* func;
+    std::string message;
+    Log::Time time;
+  };
+  // last == true for the last record of a batch
+  typedef void (*Writer)(const Record& record, bool last);
+
+  static const size_t DEFAULT_CAPACITY = 8192;
+  static const size_t MAX_BATCH = 256;
+
+  LogAsync() : cells_(NULL), mask_(0), enqueue_pos_(0), dequeue_pos_(0),
+               writer_(NULL), block_(false), running_(0), active_(0), sleeping_(0), waiting_(0),
+               dropped_(0), stop_(false) {}
+  ~LogAsync();
+
+  // capacity is rounded up to a power of 2
+  bool Enable(size_t capacity, bool block, Writer writer);
+  // writes the logs already pushed, then stops the thread
+  void Disable();
+  // returns false when not enabled, or when called on the background thread:
+  // then the caller must write the log by itself
+  bool Push(bool debug, Level level, const char* file, int line, const char* func, const char* message);
+  size_t GetDropped() const;
+
+ private:
+  struct Cell {
+    volatile size_t sequence;
+    Record record;
+  };
+
+  static void Run(void* args);
+  void _Run();
+  bool _TryPush(bool debug, Level level, const char* file, int line, const char* func, const char* message);
+  size_t _Drain();
+
+  LogAsync(const LogAsync&);
+  LogAsync& operator=(const LogAsync&);
+
+  Cell* cells_;
+  size_t mask_;
+  volatile size_t enqueue_pos_;
+  size_t dequeue_pos_; // background thread only
+  Writer writer_;
+  bool block_;
+  volatile size_t running_;
+  volatile size_t active_;   // producers between the running_ check and the end of Push
+  volatile size_t sleeping_; // background thread is (about to be) waiting on ready_cond_
+  volatile size_t waiting_;  // producers waiting on space_cond_
+  volatile size_t dropped_;
+  bool stop_;
+  uv_thread_t thread_;
+  linear::mutex enable_mutex_; // serializes Enable and Disable
+  linear::mutex mutex_;
+  linear::condition_variable ready_cond_;
+  linear::condition_variable space_cond_;
+};
+
+}  // namespace log
+
+}  // namespace linear
+
+#endif  // LINEAR_LOG_ASYNC_H_
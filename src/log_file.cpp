@@ -40,7 +40,8 @@ void LogFile::Colorize(bool flag) {
   color_ = flag;
 }
 
-void LogFile::Write(bool debug, Level level, const char* file, int line, const char* func, const char* message) {
+void LogFile::Write(bool debug, Level level, const char* file, int line, const char* func, const char* message,
+                    const Log::Time& time, bool flush) {
   linear::lock_guard<linear::mutex> lock(mutex_);
 
   if (fp_ == NULL) {
@@ -83,7 +84,7 @@ void LogFile::Write(bool debug, Level level, const char* file, int line, const c
 
   (void)(func);
   fprintf(fp_, "%s: [%s] (%s:%d) %s\n",
-          GetDateTime().c_str(),
+          GetDateTime(time).c_str(),
           strptr,
           (n == std::string::npos) ? fname.c_str() : fname.substr(n + 1).c_str(), line,
           message);
@@ -91,7 +92,7 @@ void LogFile::Write(bool debug, Level level, const char* file, int line, const c
   (void)(file);
   (void)(line);
   (void)(func);
-  fprintf(fp_, "%s: [%s] %s\n", GetDateTime().c_str(), strptr, message);
+  fprintf(fp_, "%s: [%s] %s\n", GetDateTime(time).c_str(), strptr, message);
 #endif
 
   if (color_) {
@@ -100,7 +101,9 @@ void LogFile::Write(bool debug, Level level, const char* file, int line, const c
       fprintf(fp_, "\x1b[0m");
     }
   }
-  fflush(fp_);
+  if (flush) {
+    fflush(fp_);
+  }
 }
 
 }  // namespace log
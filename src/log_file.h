@@ -17,7 +17,11 @@ class LogFile : public Log {
   virtual bool Enable(const std::string& filename);
   virtual void Disable();
   void Colorize(bool flag);
-  void Write(bool debug, linear::log::Level level, const char* file, int line, const char* func, const char* message);
+  void Write(bool debug, linear::log::Level level, const char* file, int line, const char* func, const char* message,
+             const Log::Time& time, bool flush = true);
+  void Write(bool debug, linear::log::Level level, const char* file, int line, const char* func, const char* message) {
+    Write(debug, level, file, line, func, message, Log::Now());
+  }
 
  protected:
   FILE* fp_;
@@ -14,7 +14,11 @@ class LogFunction : public Log {
   bool Available();
   bool Enable(LogCallback callback);
   void Disable();
-  void Write(bool debug, linear::log::Level level, const char* file, int line, const char* func, const char* message);
+  void Write(bool debug, linear::log::Level level, const char* file, int line, const char* func, const char* message,
+             const Log::Time& time, bool flush = true);
+  void Write(bool debug, linear::log::Level level, const char* file, int line, const char* func, const char* message) {
+    Write(debug, level, file, line, func, message, Log::Now());
+  }
 
  private:
   LogFunction(const LogFunction& rhs);
@@ -2,6 +2,7 @@
 #include "linear/mutex.h"
 #include "linear/message.h"
 #include "linear/group.h"
+#include "linear/packed_message.h"
 
 using namespace linear::log;
 
@@ -22,6 +23,12 @@ Request::Request(const std::string& m, const type::any& p)
   : Message(linear::REQUEST), msgid(GetId()), method(m), params(p), timeout_(30000) {
 }
 
+#if !defined(MSGPACK_USE_CPP03)
+Request::Request(const std::string& m, type::any&& p)
+  : Message(linear::REQUEST), msgid(GetId()), method(m), params(std::move(p)), timeout_(30000) {
+}
+#endif
+
 Error Request::Send(const Socket& socket) const {
   return socket.Send(*this, this->timeout_);
 }
@@ -55,8 +62,8 @@ Error Notify::Send(const Socket& socket) const {
 }
 
 void Notify::Send(const std::string& group_name) const {
-  std::set<linear::Socket> sockets = Group::Get(group_name);
-  if (sockets.empty()) {
+  Group::Snapshot sockets = Group::GetSnapshot(group_name);
+  if (sockets->empty()) {
     return;
   }
   if (group_name == std::string(LINEAR_BROADCAST_GROUP)) {
@@ -64,16 +71,17 @@ void Notify::Send(const std::string& group_name) const {
   } else {
     LINEAR_LOG(LOG_DEBUG, "Send to group: \"%s\"", group_name.c_str());
   }
-  std::set<linear::Socket>::iterator it = sockets.begin();
-  while (it != sockets.end()) {
-    (*it).Send(*this, 0);
+  PackedMessage packed(*this); // pack once
+  std::set<linear::Socket>::const_iterator it = sockets->begin();
+  while (it != sockets->end()) {
+    (*it).Send(packed);
     it++;
   }
 }
 
 void Notify::Send(const std::string& group_name, const Socket& except_socket) const {
-  std::set<linear::Socket> sockets = Group::Get(group_name);
-  if (sockets.empty()) {
+  Group::Snapshot sockets = Group::GetSnapshot(group_name);
+  if (sockets->empty()) {
     return;
   }
   if (group_name == std::string(LINEAR_BROADCAST_GROUP)) {
@@ -83,10 +91,11 @@ void Notify::Send(const std::string& group_name, const Socket& except_socket) co
     LINEAR_LOG(LOG_DEBUG, "Send to group: \"%s\" except for socket(id = %d)",
                group_name.c_str(), except_socket.GetId());
   }
-  std::set<linear::Socket>::iterator it = sockets.begin();
-  while (it != sockets.end()) {
+  PackedMessage packed(*this); // pack once
+  std::set<linear::Socket>::const_iterator it = sockets->begin();
+  while (it != sockets->end()) {
     if ((*it) != except_socket) {
-      (*it).Send(*this, 0);
+      (*it).Send(packed);
     }
     it++;
   }
@@ -0,0 +1,81 @@
+#include <typeinfo>
+
+#include "linear/group.h"
+#include "linear/log.h"
+#include "linear/packed_message.h"
+
+#include "shared_buffer.h"
+
+using namespace linear::log;
+
+namespace linear {
+
+volatile size_t SharedBuffer::packed_ = 0;
+
+PackedMessage::PackedMessage() {
+}
+
+PackedMessage::PackedMessage(const Message& message) {
+  try {
+    buffer_ = shared_ptr<const SharedBuffer>(new SharedBuffer(message));
+  } catch(const std::bad_typeid&) {
+    LINEAR_LOG(LOG_ERR, "invalid type of message: %d", message.type);
+  } catch(...) {
+    LINEAR_LOG(LOG_ERR, "no memory");
+  }
+}
+
+PackedMessage::PackedMessage(const PackedMessage& message) : buffer_(message.buffer_) {
+}
+
+PackedMessage& PackedMessage::operator=(const PackedMessage& message) {
+  buffer_ = message.buffer_;
+  return *this;
+}
+
+PackedMessage::~PackedMessage() {
+}
+
+const Message* PackedMessage::GetMessage() const {
+  return buffer_ ? &buffer_->GetMessage() : NULL;
+}
+
+size_t PackedMessage::GetSize() const {
+  return buffer_ ? buffer_->size() : 0;
+}
+
+Error PackedMessage::Send(const Socket& socket) const {
+  return socket.Send(*this);
+}
+
+void PackedMessage::Send(const std::string& group_name) const {
+  if (!buffer_) {
+    return;
+  }
+  Group::Snapshot sockets = Group::GetSnapshot(group_name);
+  std::set<linear::Socket>::const_iterator it = sockets->begin();
+  while (it != sockets->end()) {
+    (*it).Send(*this);
+    it++;
+  }
+}
+
+void PackedMessage::Send(const std::string& group_name, const Socket& except_socket) const {
+  if (!buffer_) {
+    return;
+  }
+  Group::Snapshot sockets = Group::GetSnapshot(group_name);
+  std::set<linear::Socket>::const_iterator it = sockets->begin();
+  while (it != sockets->end()) {
+    if ((*it) != except_socket) {
+      (*it).Send(*this);
+    }
+    it++;
+  }
+}
+
+const shared_ptr<const SharedBuffer>& PackedMessage::GetBuffer() const {
+  return buffer_;
+}
+
+}  // namespace linear
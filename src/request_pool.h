@@ -0,0 +1,75 @@
+#ifndef LINEAR_REQUEST_POOL_H_
+#define LINEAR_REQUEST_POOL_H_
+
+#include <utility>
+#include <vector>
+
+#include "linear/message.h"
+#include "linear/mutex.h"
+
+#include "unordered_map_inc.h"
+
+namespace linear {
+
+// In-flight requests of a socket, indexed by msgid.
+// Entry must have a 'request' member (linear::Request).
+// The pool does not own entries: removed entries are handed back to the caller.
+template <typename Entry>
+class RequestPool {
+ public:
+  typedef linear::unordered_multimap<uint32_t, Entry*> Map;
+
+  RequestPool() {}
+  ~RequestPool() {}
+
+  void Add(Entry* entry) {
+    linear::lock_guard<linear::mutex> lock(mutex_);
+    pool_.insert(std::make_pair(entry->request.msgid, entry));
+  }
+  // remove one of the entries which have the msgid
+  Entry* Remove(uint32_t msgid) {
+    linear::lock_guard<linear::mutex> lock(mutex_);
+    typename Map::iterator it = pool_.find(msgid);
+    if (it == pool_.end()) {
+      return NULL;
+    }
+    Entry* entry = it->second;
+    pool_.erase(it);
+    return entry;
+  }
+  // remove the entry itself (same msgid may be sent several times)
+  bool Remove(Entry* entry) {
+    linear::lock_guard<linear::mutex> lock(mutex_);
+    std::pair<typename Map::iterator, typename Map::iterator> range = pool_.equal_range(entry->request.msgid);
+    for (typename Map::iterator it = range.first; it != range.second; it++) {
+      if (it->second == entry) {
+        pool_.erase(it);
+        return true;
+      }
+    }
+    return false;
+  }
+  void RemoveAll(std::vector<Entry*>* entries) {
+    linear::lock_guard<linear::mutex> lock(mutex_);
+    entries->reserve(entries->size() + pool_.size());
+    for (typename Map::iterator it = pool_.begin(); it != pool_.end(); it++) {
+      entries->push_back(it->second);
+    }
+    pool_.clear();
+  }
+  size_t Size() {
+    linear::lock_guard<linear::mutex> lock(mutex_);
+    return pool_.size();
+  }
+
+ private:
+  RequestPool(const RequestPool& pool);
+  RequestPool& operator=(const RequestPool& pool);
+
+  Map pool_;
+  linear::mutex mutex_;
+};
+
+} // namespace linear
+
+#endif // LINEAR_REQUEST_POOL_H_
@@ -0,0 +1,226 @@
+#ifndef _WIN32
+# include <arpa/inet.h>
+#endif
+
+#include <stdint.h>
+
+#include <cstring>
+#include <map>
+
+#include "linear/log.h"
+#include "linear/mutex.h"
+
+#include "resolver.h"
+#include "uv.h"
+
+using namespace linear::log;
+
+namespace linear {
+
+namespace resolver {
+
+static int GetAddrinfo(const std::string& host, Addrinfo::Protocol* proto, std::string* address) {
+  struct addrinfo hints;
+  struct addrinfo* res = NULL;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  int r = getaddrinfo(host.c_str(), NULL, &hints, &res);
+  if (r != 0) {
+    return r;
+  }
+  // IPv4 wins when the host has both
+  struct addrinfo* found = NULL;
+  for (struct addrinfo* ai = res; ai != NULL; ai = ai->ai_next) {
+    if (ai->ai_family == AF_INET) {
+      found = ai;
+      break;
+    } else if (ai->ai_family == AF_INET6 && found == NULL) {
+      found = ai;
+    }
+  }
+  if (found == NULL) {
+    freeaddrinfo(res);
+    return EAI_FAMILY;
+  }
+  char numeric[NI_MAXHOST];
+  r = getnameinfo(found->ai_addr, static_cast<socklen_t>(found->ai_addrlen),
+                  numeric, sizeof(numeric), NULL, 0, NI_NUMERICHOST);
+  if (r == 0) {
+    *proto = (found->ai_family == AF_INET) ? Addrinfo::IPv4 : Addrinfo::IPv6;
+    *address = numeric;
+  }
+  freeaddrinfo(res);
+  return r;
+}
+
+static bool GetNumeric(const std::string& host, Addrinfo::Protocol* proto) {
+  union {
+    struct in_addr v4;
+    struct in6_addr v6;
+  } buf;
+  if (inet_pton(AF_INET, host.c_str(), &buf) == 1) {
+    *proto = Addrinfo::IPv4;
+    return true;
+  }
+  if (inet_pton(AF_INET6, host.c_str(), &buf) == 1) {
+    *proto = Addrinfo::IPv6;
+    return true;
+  }
+  return false;
+}
+
+class Cache {
+ public:
+  static Cache& GetInstance() {
+    static Cache cache;
+    return cache;
+  }
+  Cache() : ttl_(Resolver::DEFAULT_TTL), function_(GetAddrinfo) {}
+  ~Cache() {}
+
+  bool Get(const std::string& host, Addrinfo::Protocol* proto, std::string* address) {
+    lock_guard<linear::mutex> lock(mutex_);
+    Entries::iterator it = entries_.find(host);
+    if (it == entries_.end()) {
+      return false;
+    }
+    if (it->second.expire <= Now()) {
+      entries_.erase(it);
+      return false;
+    }
+    *proto = it->second.proto;
+    if (address != NULL) {
+      *address = it->second.address;
+    }
+    return true;
+  }
+  void Put(const std::string& host, Addrinfo::Protocol proto, const std::string& address) {
+    lock_guard<linear::mutex> lock(mutex_);
+    unsigned int ttl = (proto == Addrinfo::UNKNOWN && ttl_ > Resolver::NEGATIVE_TTL) ? Resolver::NEGATIVE_TTL : ttl_;
+    if (ttl == 0) {
+      return;
+    }
+    uint64_t now = Now();
+    if (entries_.size() >= Resolver::MAX_ENTRIES && entries_.find(host) == entries_.end()) {
+      Expire(now);
+      if (entries_.size() >= Resolver::MAX_ENTRIES) {
+        entries_.clear();
+      }
+    }
+    Entry& entry = entries_[host];
+    entry.proto = proto;
+    entry.address = address;
+    entry.expire = now + ttl;
+  }
+  void SetTTL(unsigned int ttl) {
+    lock_guard<linear::mutex> lock(mutex_);
+    ttl_ = ttl;
+  }
+  Resolver::Function GetFunction() {
+    lock_guard<linear::mutex> lock(mutex_);
+    return function_;
+  }
+  void SetFunction(Resolver::Function function) {
+    lock_guard<linear::mutex> lock(mutex_);
+    function_ = (function != NULL) ? function : GetAddrinfo;
+    entries_.clear();
+  }
+  void Clear() {
+    lock_guard<linear::mutex> lock(mutex_);
+    entries_.clear();
+  }
+
+ private:
+  struct Entry {
+    Addrinfo::Protocol proto;
+    std::string address; // numeric, empty on failure
+    uint64_t expire; // msec
+  };
+  typedef std::map<std::string, Entry> Entries;
+
+  static uint64_t Now() {
+    return uv_hrtime() / 1000000; // msec
+  }
+  void Expire(uint64_t now) {
+    Entries::iterator it = entries_.begin();
+    while (it != entries_.end()) {
+      if (it->second.expire <= now) {
+        entries_.erase(it++);
+      } else {
+        it++;
+      }
+    }
+  }
+
+  Cache(const Cache& cache);
+  Cache& operator=(const Cache& cache);
+  linear::mutex mutex_;
+  Entries entries_;
+  unsigned int ttl_;
+  Resolver::Function function_;
+};
+
+}  // namespace resolver
+
+Addrinfo::Protocol Resolver::Resolve(const std::string& host, std::string* address) {
+  Addrinfo::Protocol proto = Addrinfo::UNKNOWN;
+  if (Lookup(host, &proto, address)) {
+    return proto;
+  }
+  resolver::Cache& cache = resolver::Cache::GetInstance();
+  // the lock is not held while resolving: concurrent misses may resolve twice
+  Function function = cache.GetFunction();
+  std::string resolved;
+  int r = function(host, &proto, &resolved);
+  if (r != 0) {
+    LINEAR_LOG(LOG_DEBUG, "fail to resolve \"%s\": %d", host.c_str(), r);
+    proto = Addrinfo::UNKNOWN;
+    resolved.clear();
+  }
+  cache.Put(host, proto, resolved);
+  if (address != NULL) {
+    *address = resolved;
+  }
+  return proto;
+}
+
+bool Resolver::Lookup(const std::string& host, Addrinfo::Protocol* proto, std::string* address) {
+  if (resolver::GetNumeric(host, proto)) {
+    if (address != NULL) {
+      *address = host;
+    }
+    return true;
+  }
+  return resolver::Cache::GetInstance().Get(host, proto, address);
+}
+
+void Resolver::Store(const std::string& host, Addrinfo::Protocol proto, const std::string& address) {
+  Addrinfo::Protocol numeric;
+  if (proto == Addrinfo::UNKNOWN || address.empty() || resolver::GetNumeric(host, &numeric)) {
+    return;
+  }
+  resolver::Cache::GetInstance().Put(host, proto, address);
+}
+
+std::string Resolver::GetAddress(const std::string& host) {
+  Addrinfo::Protocol proto;
+  std::string address;
+  if (Lookup(host, &proto, &address) && proto != Addrinfo::UNKNOWN) {
+    return address;
+  }
+  return host;
+}
+
+void Resolver::SetTTL(unsigned int ttl) {
+  resolver::Cache::GetInstance().SetTTL(ttl);
+}
+
+void Resolver::SetFunction(Function function) {
+  resolver::Cache::GetInstance().SetFunction(function);
+}
+
+void Resolver::Clear() {
+  resolver::Cache::GetInstance().Clear();
+}
+
+}  // namespace linear
@@ -0,0 +1,40 @@
+#ifndef LINEAR_RESOLVER_H_
+#define LINEAR_RESOLVER_H_
+
+#include <string>
+
+#include "linear/addrinfo.h"
+
+namespace linear {
+
+// Process-wide cache of host name -> numeric address and its family, shared
+// by all clients and servers. Numeric addresses never reach the resolver function.
+// Failures are cached too, for a shorter time.
+class Resolver {
+ public:
+  // returns 0 and sets proto and the numeric address (e.g. "127.0.0.1") on success
+  typedef int (*Function)(const std::string& host, Addrinfo::Protocol* proto, std::string* address);
+
+  static const unsigned int DEFAULT_TTL = 60 * 1000;  // msec
+  static const unsigned int NEGATIVE_TTL = 5 * 1000;  // msec
+  static const size_t MAX_ENTRIES = 1024;
+
+  // may block on getaddrinfo when host is not cached
+  static Addrinfo::Protocol Resolve(const std::string& host, std::string* address = NULL);
+  // never blocks: returns false when host is neither numeric nor cached
+  static bool Lookup(const std::string& host, Addrinfo::Protocol* proto, std::string* address = NULL);
+  // records an address learned elsewhere (e.g. by an asynchronous connect)
+  static void Store(const std::string& host, Addrinfo::Protocol proto, const std::string& address);
+  // never blocks: what to hand to tv_connect or tv_listen, so that libtv does not
+  // resolve host again; the cached numeric address, or host itself when not cached
+  static std::string GetAddress(const std::string& host);
+
+  static void SetTTL(unsigned int ttl);
+  // NULL restores getaddrinfo
+  static void SetFunction(Function function);
+  static void Clear();
+};
+
+}  // namespace linear
+
+#endif  // LINEAR_RESOLVER_H_
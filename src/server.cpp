@@ -14,6 +14,46 @@ Error Server::SetMaxClients(size_t max_clients) const {
   return Error(LNR_OK);
 }
 
+Error Server::SetWorkerPool(const WorkerPool& workers) const {
+  if (!server_) {
+    return Error(LNR_EINVAL);
+  }
+  server_->SetWorkerPool(workers.GetImpl());
+  return Error(LNR_OK);
+}
+
+Error Server::SetBacklog(int backlog) const {
+  if (!server_ || backlog <= 0) {
+    return Error(LNR_EINVAL);
+  }
+  server_->SetBacklog(backlog);
+  return Error(LNR_OK);
+}
+
+Stats Server::GetStats() const {
+  Stats stats;
+  if (server_) {
+    server_->GetStats(&stats);
+  }
+  return stats;
+}
+
+Error Server::SetLatencyStats(bool enable) const {
+  if (!server_) {
+    return Error(LNR_EINVAL);
+  }
+  server_->SetLatencyStats(enable);
+  return Error(LNR_OK);
+}
+
+MethodLatencies Server::GetLatencyStats(bool reset) const {
+  MethodLatencies latencies;
+  if (server_) {
+    server_->GetLatencyStats(&latencies, reset);
+  }
+  return latencies;
+}
+
 Error Server::Start(const std::string& host, int port) const {
   if (!server_) {
     return Error(LNR_EINVAL);
@@ -7,7 +7,8 @@ namespace linear {
 
 class ServerImpl : public HandlerDelegate {
  public:
-  static const int BACKLOG = 10; // backlog = 10
+  // pending connections the kernel keeps per listener, capped by net.core.somaxconn
+  static const int DEFAULT_BACKLOG = 128;
   enum State {
     STOP,
     START
@@ -17,8 +18,23 @@ class ServerImpl : public HandlerDelegate {
   ServerImpl(const linear::weak_ptr<linear::Handler>& handler,
              const linear::EventLoop& loop,
              bool show_ssl_version = false)
-    : HandlerDelegate(handler, loop, show_ssl_version), state_(STOP) {}
+    : HandlerDelegate(handler, loop, show_ssl_version), state_(STOP), backlog_(DEFAULT_BACKLOG) {}
   virtual ~ServerImpl() {}
+  // applied at the next Start
+  void SetBacklog(int backlog) {
+    linear::lock_guard<linear::mutex> lock(mutex_);
+    backlog_ = backlog;
+  }
+  void GetStats(linear::Stats* stats) {
+    stats_->Snapshot(stats);
+    stats->connections = pool_.Size();
+  }
+  void SetLatencyStats(bool enable) {
+    latencies_->SetEnabled(enable);
+  }
+  void GetLatencyStats(linear::MethodLatencies* latencies, bool reset) {
+    latencies_->Snapshot(latencies, reset);
+  }
   virtual linear::Error Start(const std::string& hostname, int port,
                               linear::EventLoopImpl::ServerEvent* ev) = 0;
   virtual linear::Error Stop() = 0;
@@ -30,6 +46,7 @@ class ServerImpl : public HandlerDelegate {
 
  protected:
   linear::ServerImpl::State state_;
+  int backlog_;
   linear::Addrinfo self_;
   linear::mutex mutex_;
 };
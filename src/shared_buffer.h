@@ -0,0 +1,71 @@
+#ifndef LINEAR_SHARED_BUFFER_H_
+#define LINEAR_SHARED_BUFFER_H_
+
+#include <typeinfo>
+
+#include "linear/message.h"
+
+#include "atomic_ops.h"
+#include "tv.h"
+
+namespace linear {
+
+// A message packed once, to be written to any number of sockets.
+// Keeps a copy of the message to report errors with.
+class SharedBuffer {
+ public:
+  explicit SharedBuffer(const linear::Message& message) : message_(NULL) {
+    switch(message.type) {
+    case linear::REQUEST:
+      msgpack::pack(sbuf_, static_cast<const linear::Request&>(message));
+      message_ = new linear::Request(static_cast<const linear::Request&>(message));
+      break;
+    case linear::RESPONSE:
+      msgpack::pack(sbuf_, static_cast<const linear::Response&>(message));
+      message_ = new linear::Response(static_cast<const linear::Response&>(message));
+      break;
+    case linear::NOTIFY:
+      msgpack::pack(sbuf_, static_cast<const linear::Notify&>(message));
+      message_ = new linear::Notify(static_cast<const linear::Notify&>(message));
+      break;
+    default:
+      throw std::bad_typeid();
+    }
+    atomic::FetchAddRelaxed(&packed_, static_cast<size_t>(1));
+  }
+  ~SharedBuffer() {
+    delete message_;
+  }
+  const linear::Message& GetMessage() const {
+    return *message_;
+  }
+  const char* data() const {
+    return sbuf_.data();
+  }
+  size_t size() const {
+    return sbuf_.size();
+  }
+  // number of messages packed so far, e.g. to check that a group send packs once
+  static size_t GetPackedCount() {
+    return atomic::LoadRelaxed(&packed_);
+  }
+
+ private:
+  SharedBuffer(const SharedBuffer& buffer);
+  SharedBuffer& operator=(const SharedBuffer& buffer);
+
+  static volatile size_t packed_;
+  linear::Message* message_;
+  msgpack::sbuffer sbuf_;
+};
+
+// tv_write_t of a SharedBuffer, which holds the buffer until the write completes
+struct SharedWriteRequest {
+  SharedWriteRequest(const linear::shared_ptr<const linear::SharedBuffer>& b) : buffer(b) {}
+  tv_write_t write;
+  linear::shared_ptr<const linear::SharedBuffer> buffer;
+};
+
+} // namespace linear
+
+#endif // LINEAR_SHARED_BUFFER_H_
@@ -1,4 +1,5 @@
 #include "linear/log.h"
+#include "linear/packed_message.h"
 
 #include "socket_impl.h"
 
@@ -6,28 +7,6 @@ using namespace linear::log;
 
 namespace linear {
 
-static std::string GetTypeString(Socket::Type type) {
-  std::string proto("NIL");
-  switch(type) {
-  case Socket::TCP:
-    proto = "TCP";
-    break;
-  case Socket::SSL:
-    proto = "SSL";
-    break;
-  case Socket::WS:
-    proto = "WS";
-    break;
-  case Socket::WSS:
-    proto = "WSS";
-    break;
-  case Socket::NIL:
-  default:
-    break;
-  }
-  return proto;  
-}
-
 Socket::Socket() : socket_() {
 }
 
@@ -93,6 +72,21 @@ Error Socket::SetMaxRecvBufferSize(size_t limit) const {
   return Error(LNR_OK);
 }
 
+Error Socket::SetWriteCoalescing(bool enable) const {
+  if (!socket_) {
+    return Error(LNR_EBADF);
+  }
+  socket_->SetWriteCoalescing(enable);
+  return Error(LNR_OK);
+}
+
+Error Socket::SetReconnect(bool enable, const Socket::ReconnectPolicy& policy) const {
+  if (!socket_) {
+    return Error(LNR_EBADF);
+  }
+  return socket_->SetReconnect(enable, policy);
+}
+
 Error Socket::Connect(unsigned int timeout) const {
   if (!socket_) {
     return Error(LNR_EBADF);
@@ -114,15 +108,11 @@ Error Socket::Disconnect() const {
   if (!socket_) {
     return Error(LNR_EBADF);
   }
-  const linear::Addrinfo& self = GetSelfInfo();
-  const linear::Addrinfo& peer = GetPeerInfo();
-  LINEAR_LOG(LOG_DEBUG, "try to disconnect(id = %d): %s:%d x-- %s --- %s:%d",
+  LINEAR_LOG(LOG_DEBUG, "try to disconnect(id = %d): %s x-- %s --- %s",
              GetId(),
-             (self.proto == Addrinfo::IPv4) ? self.addr.c_str() : (std::string("[" + self.addr + "]")).c_str(),
-             self.port,
-             GetTypeString(GetType()).c_str(),
-             (peer.proto == Addrinfo::IPv4) ? peer.addr.c_str() : (std::string("[" + peer.addr + "]")).c_str(),
-             peer.port);
+             socket_->GetSelfLabel()->c_str(),
+             SocketImpl::GetTypeName(GetType()),
+             socket_->GetPeerLabel()->c_str());
   return socket_->Disconnect();
 }
 
@@ -184,6 +174,21 @@ const Addrinfo& Socket::GetPeerInfo() const {
   return socket_->GetPeerInfo();
 }
 
+size_t Socket::GetOutstandingRequests() const {
+  if (!socket_) {
+    return 0;
+  }
+  return socket_->GetOutstandingRequests();
+}
+
+Stats Socket::GetStats() const {
+  Stats stats;
+  if (socket_) {
+    socket_->GetStats(&stats);
+  }
+  return stats;
+}
+
 Error Socket::Send(const Message& message, int timeout) const {
   if (!socket_) {
     return Error(LNR_EBADF);
@@ -191,4 +196,25 @@ Error Socket::Send(const Message& message, int timeout) const {
   return socket_->Send(message, timeout);
 }
 
+#if !defined(MSGPACK_USE_CPP03)
+Error Socket::Send(Message&& message, int timeout) const {
+  if (!socket_) {
+    return Error(LNR_EBADF);
+  }
+  return socket_->Send(std::move(message), timeout);
+}
+#endif
+
+Error Socket::Send(const PackedMessage& message) const {
+  if (!socket_) {
+    return Error(LNR_EBADF);
+  }
+  const Message* original = message.GetMessage();
+  if (original == NULL) {
+    return Error(LNR_EINVAL);
+  }
+  int timeout = (original->type == REQUEST) ? static_cast<const Request*>(original)->timeout_ : 0;
+  return socket_->Send(message.GetBuffer(), timeout);
+}
+
 } // namespace linear
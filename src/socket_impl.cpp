@@ -1,9 +1,14 @@
+#include <cstdio>
+#include <cstring>
 #include <sstream>
 
 #include "linear/ws_socket.h"
 
 #include "ws_socket_impl.h"
 #include "handler_delegate.h"
+#include "resolver.h"
+#include "shared_buffer.h"
+#include "write_buffer.h"
 
 #ifdef WITH_SSL
 # include "linear/wss_socket.h"
@@ -22,47 +27,36 @@ static int Id() {
   return id++;
 }
 
-static std::string GetTypeString(Socket::Type type) {
-  std::string proto("NIL");
-  switch(type) {
-  case Socket::TCP:
-    proto = "TCP";
-    break;
-  case Socket::SSL:
-    proto = "SSL";
-    break;
-  case Socket::WS:
-    proto = "WS";
-    break;
-  case Socket::WSS:
-    proto = "WSS";
-    break;
-  case Socket::NIL:
-  default:
-    break;
-  }
-  return proto;  
-}
-
 // Client Socket
 SocketImpl::SocketImpl(const std::string& host, int port,
                        const linear::shared_ptr<linear::EventLoopImpl>& loop,
                        const weak_ptr<HandlerDelegate>& delegate,
                        Socket::Type type)
   : state_(Socket::DISCONNECTED),
-    stream_(NULL), ev_(NULL), peer_(Addrinfo(host, port)), loop_(loop), type_(type), id_(Id()),
+    stream_(NULL), ev_(NULL), loop_(loop), self_pending_(false), peer_pending_(false), type_(type), id_(Id()),
     connectable_(true), handshaking_(false), last_error_(LNR_OK), delegate_(delegate),
-    connect_timeout_(0), connect_timer_(loop_) {
+    connect_timeout_(0), connect_timer_(loop_), write_coalescing_(false), flush_timer_(loop_),
+    reconnect_timer_(loop_), reconnect_ev_(NULL), reconnect_enabled_(false), reconnecting_(false),
+    reconnect_attempts_(0), reconnect_random_(static_cast<uint32_t>(uv_hrtime()) ^ static_cast<uint32_t>(id_) ^ 1),
+    queued_(0), observed_(0) {
   SetMaxBufferSize(Socket::DEFAULT_MAX_BUFFER_SIZE);
-  if (peer_.proto == Addrinfo::UNKNOWN) {
+  // never blocks on DNS: a host name that is not cached yet is resolved
+  // asynchronously by tv_connect, and its address is learned at connect
+  peer_.addr = host;
+  peer_.port = port;
+  bool known = Resolver::Lookup(host, &peer_.proto);
+  if (known && peer_.proto == Addrinfo::UNKNOWN) {
     LINEAR_LOG(LOG_ERR, "fail to create socket(id = %d, type = %s, peer = [%s]:%d, connectable): address not available",
-               id_, GetTypeString(type_).c_str(),
+               id_, GetTypeName(type_),
+               host.c_str(), port);
+  } else if (!known) {
+    LINEAR_LOG(LOG_DEBUG, "socket(id = %d, type = %s, peer = %s:%d, connectable) is created, resolves at connect",
+               id_, GetTypeName(type_),
                host.c_str(), port);
   } else {
-    LINEAR_LOG(LOG_DEBUG, "socket(id = %d, type = %s, peer = %s:%d, connectable) is created",
-               id_, GetTypeString(type_).c_str(),
-               (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-               peer_.port);
+    LINEAR_LOG(LOG_DEBUG, "socket(id = %d, type = %s, peer = %s, connectable) is created",
+               id_, GetTypeName(type_),
+               GetPeerLabel()->c_str());
   }
 }
 
@@ -71,9 +65,12 @@ SocketImpl::SocketImpl(tv_stream_t* stream,
                        const linear::shared_ptr<linear::EventLoopImpl>& loop,
                        const weak_ptr<HandlerDelegate>& delegate,
                        Socket::Type type)
-  : stream_(stream), ev_(NULL), loop_(loop), type_(type), id_(Id()),
+  : stream_(stream), ev_(NULL), loop_(loop), self_pending_(false), peer_pending_(false), type_(type), id_(Id()),
     connectable_(false), last_error_(LNR_OK), delegate_(delegate),
-    connect_timeout_(0), connect_timer_(loop_) {
+    connect_timeout_(0), connect_timer_(loop_), write_coalescing_(false), flush_timer_(loop_),
+    reconnect_timer_(loop_), reconnect_ev_(NULL), reconnect_enabled_(false), reconnecting_(false),
+    reconnect_attempts_(0), reconnect_random_(static_cast<uint32_t>(uv_hrtime()) ^ static_cast<uint32_t>(id_) ^ 1),
+    queued_(0), observed_(0) {
   if (type == Socket::WS) {
     handshaking_ = true;
     state_ = Socket::CONNECTING;
@@ -90,6 +87,9 @@ SocketImpl::SocketImpl(tv_stream_t* stream,
     handshaking_ = false;
     state_ = Socket::CONNECTED;
   }
+  if (shared_ptr<HandlerDelegate> server = delegate.lock()) {
+    server_stats_ = server->GetStatsCounters();
+  }
   union {
     struct sockaddr_storage ss;
     struct sockaddr sa;
@@ -97,32 +97,114 @@ SocketImpl::SocketImpl(tv_stream_t* stream,
   int len = sizeof(addr);
   int ret = tv_getsockname(stream_, &addr.sa, &len);
   if (ret == 0) {
-    self_ = Addrinfo(&addr.sa);
+    _SetSelfInfo(&addr.sa);
   } else {
     LINEAR_LOG(LOG_WARN, "fail to get selfinfo(id = %d): %s",
                id_, tv_strerror(reinterpret_cast<tv_handle_t*>(stream_), ret));
   }
+  len = sizeof(addr);
   ret = tv_getpeername(stream_, &addr.sa, &len);
   if (ret == 0) {
-    peer_ = Addrinfo(&addr.sa);
+    _SetPeerInfo(&addr.sa);
   } else {
     LINEAR_LOG(LOG_WARN, "fail to get peerinfo(id = %d) (may disconnected by peer): %s",
                id_, tv_strerror(reinterpret_cast<tv_handle_t*>(stream_), ret));
   }
   SetMaxBufferSize(Socket::DEFAULT_MAX_BUFFER_SIZE);
-  LINEAR_LOG(LOG_DEBUG, "socket(id = %d, type = %s, self = %s:%d, peer = %s:%d, not connectable) is created",
-             id_, GetTypeString(type_).c_str(),
-             (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-             self_.port,
-             (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-             peer_.port);
+  LINEAR_LOG(LOG_DEBUG, "socket(id = %d, type = %s, self = %s, peer = %s, not connectable) is created",
+             id_, GetTypeName(type_),
+             GetSelfLabel()->c_str(),
+             GetPeerLabel()->c_str());
 }
 
 SocketImpl::~SocketImpl() {
   Disconnect(false);
+  reconnect_timer_.Stop();
+  delete reconnect_ev_;
+  // an outbox left by a socket that was waiting to reconnect
+  for (std::vector<Outgoing>::iterator it = pending_messages_.begin(); it != pending_messages_.end(); it++) {
+    delete it->message;
+  }
+  std::vector<RequestTimer*> request_timers;
+  request_timers_.RemoveAll(&request_timers);
+  for (std::vector<RequestTimer*>::iterator it = request_timers.begin(); it != request_timers.end(); it++) {
+    delete *it;
+  }
+  // writes and requests left behind never complete for this socket
+  if (server_stats_) {
+    server_stats_->Sub(StatsCounters::SEND_QUEUE_DEPTH, stats_.Get(StatsCounters::SEND_QUEUE_DEPTH));
+    server_stats_->Sub(StatsCounters::OUTSTANDING_REQUESTS, stats_.Get(StatsCounters::OUTSTANDING_REQUESTS));
+  }
   LINEAR_LOG(LOG_DEBUG, "socket(id = %d) is destroyed", id_);
 }
 
+const char* SocketImpl::GetTypeName(Socket::Type type) {
+  switch(type) {
+  case Socket::TCP:
+    return "TCP";
+  case Socket::SSL:
+    return "SSL";
+  case Socket::WS:
+    return "WS";
+  case Socket::WSS:
+    return "WSS";
+  case Socket::NIL:
+  default:
+    return "NIL";
+  }
+}
+
+static std::string MakeLabel(const Addrinfo& info) {
+  char port[16];
+  snprintf(port, sizeof(port), ":%d", info.port);
+  if (info.proto == Addrinfo::IPv4) {
+    return info.addr + port;
+  }
+  return "[" + info.addr + "]" + port;
+}
+
+const Addrinfo& SocketImpl::GetSelfInfo() {
+  lock_guard<mutex> info_lock(info_mutex_);
+  if (self_pending_) {
+    self_ = Addrinfo(&self_addr_.sa);
+    self_pending_ = false;
+  }
+  return self_;
+}
+
+const Addrinfo& SocketImpl::GetPeerInfo() {
+  lock_guard<mutex> info_lock(info_mutex_);
+  if (peer_pending_) {
+    peer_ = Addrinfo(&peer_addr_.sa);
+    peer_pending_ = false;
+  }
+  return peer_;
+}
+
+shared_ptr<const std::string> SocketImpl::GetSelfLabel() {
+  lock_guard<mutex> info_lock(info_mutex_);
+  if (self_pending_) {
+    self_ = Addrinfo(&self_addr_.sa);
+    self_pending_ = false;
+  }
+  if (!self_label_) {
+    self_label_ = shared_ptr<const std::string>(new std::string(MakeLabel(self_)));
+  }
+  return self_label_;
+}
+
+shared_ptr<const std::string> SocketImpl::GetPeerLabel() {
+  lock_guard<mutex> info_lock(info_mutex_);
+  if (peer_pending_) {
+    peer_ = Addrinfo(&peer_addr_.sa);
+    peer_pending_ = false;
+  }
+  if (!peer_label_) {
+    peer_label_ = shared_ptr<const std::string>(new std::string(MakeLabel(peer_)));
+  }
+  return peer_label_;
+}
+
 void SocketImpl::SetMaxBufferSize(size_t limit) {
   SetMaxSendBufferSize(limit);
   SetMaxRecvBufferSize(limit);
@@ -139,12 +221,67 @@ void SocketImpl::SetMaxRecvBufferSize(size_t limit) {
   max_recv_buffer_size_ = limit;
 }
 
+void SocketImpl::SetWriteCoalescing(bool enable) {
+  lock_guard<mutex> state_lock(state_mutex_);
+  write_coalescing_ = enable;
+}
+
+void SocketImpl::AddRequestObserver(const shared_ptr<RequestObserver>& observer) {
+  lock_guard<mutex> lock(observers_mutex_);
+  observers_.push_back(observer);
+  atomic::StoreRelaxed(&observed_, observers_.size());
+}
+
+void SocketImpl::RemoveRequestObserver(const shared_ptr<RequestObserver>& observer) {
+  lock_guard<mutex> lock(observers_mutex_);
+  for (std::vector<weak_ptr<RequestObserver> >::iterator it = observers_.begin(); it != observers_.end(); it++) {
+    if (it->lock() == observer) {
+      observers_.erase(it);
+      break;
+    }
+  }
+  atomic::StoreRelaxed(&observed_, observers_.size());
+}
+
+Error SocketImpl::SetReconnect(bool enable, const Socket::ReconnectPolicy& policy) {
+  lock_guard<mutex> state_lock(state_mutex_);
+  if (!connectable_) {
+    return Error(LNR_EINVAL);
+  }
+  reconnect_enabled_ = enable;
+  reconnect_policy_ = policy;
+  if (reconnect_policy_.jitter < 0.0) {
+    reconnect_policy_.jitter = 0.0;
+  } else if (reconnect_policy_.jitter > 1.0) {
+    reconnect_policy_.jitter = 1.0;
+  }
+  if (!enable && reconnecting_ && state_ == Socket::DISCONNECTED) {
+    // OnReconnect cancels the outbox on the event loop
+    reconnecting_ = false;
+    reconnect_timer_.Stop();
+    reconnect_timer_.Start(EventLoopImpl::OnReconnect, 0, reconnect_ev_);
+  }
+  return Error(LNR_OK);
+}
+
 Error SocketImpl::Connect(unsigned int timeout, EventLoopImpl::SocketEvent* ev) {
   lock_guard<mutex> state_lock(state_mutex_);
-  if (!connectable_ || peer_.proto == Addrinfo::UNKNOWN) {
+  if (!connectable_) {
     LINEAR_LOG(LOG_WARN, "this socket(id = %d) is not connectable", id_);
     return Error(LNR_EINVAL);
   }
+  Addrinfo::Protocol proto;
+  if (Resolver::Lookup(peer_.addr, &proto)) {
+    if (proto == Addrinfo::UNKNOWN) {
+      LINEAR_LOG(LOG_WARN, "this socket(id = %d) is not connectable: address not available", id_);
+      return Error(LNR_EINVAL);
+    }
+    lock_guard<mutex> info_lock(info_mutex_);
+    if (peer_.proto != proto) {
+      peer_.proto = proto;
+      peer_label_.reset();
+    }
+  }
   if (state_ == Socket::CONNECTING || state_ == Socket::CONNECTED) {
     LINEAR_LOG(LOG_INFO, "this socket(id = %d) is %s",
                id_,
@@ -154,11 +291,10 @@ Error SocketImpl::Connect(unsigned int timeout, EventLoopImpl::SocketEvent* ev)
     LINEAR_LOG(LOG_WARN, "this socket(id = %d) is disconnecting now.plz call later.", id_);
     return Error(LNR_EBUSY);
   }
-  LINEAR_LOG(LOG_DEBUG, "try to connect(id = %d): --- %s --> %s:%d",
+  LINEAR_LOG(LOG_DEBUG, "try to connect(id = %d): --- %s --> %s",
              id_,
-             GetTypeString(type_).c_str(),
-             (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-             peer_.port);
+             GetTypeName(type_),
+             GetPeerLabel()->c_str());
   ev_ = ev;
   Error err;
   shared_ptr<HandlerDelegate> delegate = delegate_.lock();
@@ -170,10 +306,14 @@ Error SocketImpl::Connect(unsigned int timeout, EventLoopImpl::SocketEvent* ev)
       return err;
     }
   }
-  self_ = Addrinfo(); // reset self info
+  _ResetSelfInfo();
   err = Connect();
   if (err == Error(LNR_OK)) {
     state_ = Socket::CONNECTING;
+    if (reconnecting_) { // connected by hand while waiting to reconnect
+      reconnecting_ = false;
+      reconnect_timer_.Stop();
+    }
     if (timeout > 0) {
       connect_timeout_ = timeout;
       connect_timer_.Start(EventLoopImpl::OnConnectTimeout, connect_timeout_, ev_);
@@ -192,6 +332,13 @@ Error SocketImpl::Connect(unsigned int timeout, EventLoopImpl::SocketEvent* ev)
 Error SocketImpl::Disconnect(bool handshaking) {
   lock_guard<mutex> state_lock(state_mutex_);
   handshaking_ = handshaking;
+  if (reconnecting_ && state_ == Socket::DISCONNECTED) {
+    // OnReconnect cancels the outbox on the event loop
+    reconnecting_ = false;
+    reconnect_timer_.Stop();
+    reconnect_timer_.Start(EventLoopImpl::OnReconnect, 0, reconnect_ev_);
+    return Error(LNR_OK);
+  }
   if (state_ == Socket::DISCONNECTING || state_ == Socket::DISCONNECTED) {
     return Error(LNR_EALREADY);
   }
@@ -202,40 +349,51 @@ Error SocketImpl::Disconnect(bool handshaking) {
   return Error(LNR_OK);
 }
 
+static Message* CopyMessage(const Message& message, int timeout) {
+  switch(message.type) {
+  case linear::REQUEST:
+    {
+      Request* copy_request = new Request(static_cast<const Request&>(message));
+      copy_request->timeout_ = timeout;
+      return copy_request;
+    }
+  case linear::RESPONSE:
+    return new Response(static_cast<const Response&>(message));
+  case linear::NOTIFY:
+    return new Notify(static_cast<const Notify&>(message));
+  default:
+    LINEAR_LOG(LOG_ERR, "invalid type of message: %d", message.type);
+    throw std::bad_typeid();
+  }
+}
+
+#if !defined(MSGPACK_USE_CPP03)
+static Message* MoveMessage(Message&& message, int timeout) {
+  switch(message.type) {
+  case linear::REQUEST:
+    {
+      Request* move_request = new Request(std::move(static_cast<Request&>(message)));
+      move_request->timeout_ = timeout;
+      return move_request;
+    }
+  case linear::RESPONSE:
+    return new Response(std::move(static_cast<Response&>(message)));
+  case linear::NOTIFY:
+    return new Notify(std::move(static_cast<Notify&>(message)));
+  default:
+    LINEAR_LOG(LOG_ERR, "invalid type of message: %d", message.type);
+    throw std::bad_typeid();
+  }
+}
+#endif
+
 Error SocketImpl::Send(const Message& message, int timeout) {
   lock_guard<mutex> state_lock(state_mutex_);
-  if (state_ == Socket::DISCONNECTING || state_ == Socket::DISCONNECTED) {
+  if (state_ == Socket::DISCONNECTING || (state_ == Socket::DISCONNECTED && !reconnecting_)) {
     return Error(LNR_ENOTCONN);
   }
   try {
-    Message* copy_message;
-    switch(message.type) {
-    case linear::REQUEST:
-      {
-        Request* copy_request = new Request(static_cast<const Request&>(message));
-        copy_request->timeout_ = timeout;
-        copy_message = copy_request;
-      }
-      break;
-    case linear::RESPONSE:
-      copy_message = new Response(static_cast<const Response&>(message));
-      break;
-    case linear::NOTIFY:
-      copy_message = new Notify(static_cast<const Notify&>(message));
-      break;
-    default:
-      LINEAR_LOG(LOG_ERR, "invalid type of message: %d", message.type);
-      throw std::bad_typeid();
-    }
-    if (state_ == Socket::CONNECTING) {
-      pending_messages_.push_back(copy_message);
-      return Error(LNR_OK);
-    }
-    Error err = _Send(copy_message);
-    if (err != Error(LNR_OK)) {
-      delete copy_message;
-    }
-    return err;
+    return _Queue(Outgoing(CopyMessage(message, timeout)));
   } catch(const std::bad_typeid&) {
     return Error(LNR_EINVAL);
   } catch(...) {
@@ -243,6 +401,35 @@ Error SocketImpl::Send(const Message& message, int timeout) {
   }
 }
 
+#if !defined(MSGPACK_USE_CPP03)
+Error SocketImpl::Send(Message&& message, int timeout) {
+  lock_guard<mutex> state_lock(state_mutex_);
+  if (state_ == Socket::DISCONNECTING || (state_ == Socket::DISCONNECTED && !reconnecting_)) {
+    return Error(LNR_ENOTCONN);
+  }
+  try {
+    return _Queue(Outgoing(MoveMessage(std::move(message), timeout)));
+  } catch(const std::bad_typeid&) {
+    return Error(LNR_EINVAL);
+  } catch(...) {
+    return Error(LNR_ENOMEM);
+  }
+}
+#endif
+
+Error SocketImpl::Send(const shared_ptr<const SharedBuffer>& buffer, int timeout) {
+  lock_guard<mutex> state_lock(state_mutex_);
+  if (state_ == Socket::DISCONNECTING || (state_ == Socket::DISCONNECTED && !reconnecting_)) {
+    return Error(LNR_ENOTCONN);
+  }
+  try {
+    // queued as is, so that the buffer is neither copied nor packed again
+    return _Queue(Outgoing(buffer, timeout));
+  } catch(...) {
+    return Error(LNR_ENOMEM);
+  }
+}
+
 Error SocketImpl::KeepAlive(unsigned int interval, unsigned int retry, Socket::KeepAliveType type) {
   lock_guard<mutex> state_lock(state_mutex_);
   if (state_ != Socket::CONNECTING && state_ != Socket::CONNECTED) {
@@ -295,13 +482,11 @@ Error SocketImpl::StartRead(EventLoopImpl::SocketEvent* ev) {
     tv_close(reinterpret_cast<tv_handle_t*>(stream_), EventLoopImpl::OnClose);
     return Error(ret);
   }
-  LINEAR_LOG(LOG_DEBUG, "connected(id = %d): %s:%d <-- %s --> %s:%d",
+  LINEAR_LOG(LOG_DEBUG, "connected(id = %d): %s <-- %s --> %s",
              id_,
-             (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-             self_.port,
-             GetTypeString(type_).c_str(),
-             (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-             peer_.port);
+             GetSelfLabel()->c_str(),
+             GetTypeName(type_),
+             GetPeerLabel()->c_str());
   return Error(LNR_OK);
 }
 
@@ -312,11 +497,10 @@ void SocketImpl::OnConnect(const shared_ptr<SocketImpl>& socket, tv_stream_t* st
     return;
   }
   if (state_ != Socket::CONNECTING) {
-    LINEAR_LOG(LOG_DEBUG, "connect(id = %d) is cancelled: x-- %s --> %s:%d",
+    LINEAR_LOG(LOG_DEBUG, "connect(id = %d) is cancelled: x-- %s --> %s",
                id_,
-               GetTypeString(type_).c_str(),
-               (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-               peer_.port);
+               GetTypeName(type_),
+               GetPeerLabel()->c_str());
     return;
   }
   if (status) {
@@ -337,12 +521,11 @@ void SocketImpl::OnConnect(const shared_ptr<SocketImpl>& socket, tv_stream_t* st
     (void)(stream);
 #endif
 
-    LINEAR_LOG(LOG_DEBUG, "fail to connect(id = %d), %s: --- %s --x %s:%d",
+    LINEAR_LOG(LOG_DEBUG, "fail to connect(id = %d), %s: --- %s --x %s",
                id_,
                last_error_.Message().c_str(),
-               GetTypeString(type_).c_str(),
-               (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-               peer_.port);
+               GetTypeName(type_),
+               GetPeerLabel()->c_str());
     state_lock.unlock();
     tv_close(reinterpret_cast<tv_handle_t*>(stream_), EventLoopImpl::OnClose);
     return;
@@ -354,20 +537,31 @@ void SocketImpl::OnConnect(const shared_ptr<SocketImpl>& socket, tv_stream_t* st
   int len = sizeof(addr);
   int ret = tv_getsockname(stream_, &addr.sa, &len);
   if (ret == 0) {
-    self_ = Addrinfo(&addr.sa);
+    _SetSelfInfo(&addr.sa);
+    if (peer_.proto == Addrinfo::UNKNOWN) {
+      // the host name was resolved by tv_connect: caches the address it connected to,
+      // so that the next connect goes there without DNS
+      lock_guard<mutex> info_lock(info_mutex_);
+      peer_.proto = (addr.sa.sa_family == AF_INET) ? Addrinfo::IPv4 :
+                    (addr.sa.sa_family == AF_INET6) ? Addrinfo::IPv6 : Addrinfo::UNKNOWN;
+      peer_label_.reset();
+      len = sizeof(addr);
+      if (tv_getpeername(stream_, &addr.sa, &len) == 0) {
+        Addrinfo peer(&addr.sa);
+        Resolver::Store(peer_.addr, peer.proto, peer.addr);
+      }
+    }
   }
   SetMaxSendBufferSize(max_send_buffer_size_);
   // OK.starts to read
   last_error_ = StartRead(ev_);
   if (last_error_ != Error(LNR_OK)) {
-    LINEAR_LOG(LOG_DEBUG, "fail to connect(id = %d), %s: %s:%d --- %s --x %s:%d",
+    LINEAR_LOG(LOG_DEBUG, "fail to connect(id = %d), %s: %s --- %s --x %s",
                id_,
                last_error_.Message().c_str(),
-               (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-               self_.port,
-               GetTypeString(type_).c_str(),
-               (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-               peer_.port);
+               GetSelfLabel()->c_str(),
+               GetTypeName(type_),
+               GetPeerLabel()->c_str());
     return;
   }
   state_lock.unlock();
@@ -379,6 +573,10 @@ void SocketImpl::OnConnect(const shared_ptr<SocketImpl>& socket, tv_stream_t* st
   if (state_ == Socket::CONNECTING) {
     state_ = Socket::CONNECTED;
   }
+  if (reconnect_attempts_ > 0) {
+    _Count(StatsCounters::RECONNECTS, 1);
+  }
+  reconnect_attempts_ = 0;
   state_lock.unlock();
   _SendPendingMessages(socket);
 }
@@ -392,6 +590,7 @@ void SocketImpl::OnHandshakeComplete(const shared_ptr<SocketImpl>& socket, tv_st
   }
   handshaking_ = false;
   state_ = Socket::CONNECTED;
+  reconnect_attempts_ = 0;
   state_lock.unlock();
   _SendPendingMessages(socket);
 }
@@ -402,13 +601,11 @@ void SocketImpl::OnDisconnect(const shared_ptr<SocketImpl>& socket) {
   if (state_ == Socket::DISCONNECTED) {
     return;
   }
-  LINEAR_LOG(LOG_DEBUG, "disconnected(id = %d): %s:%d x-- %s --x %s:%d",
+  LINEAR_LOG(LOG_DEBUG, "disconnected(id = %d): %s x-- %s --x %s",
              id_,
-             (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-             self_.port,
-             GetTypeString(type_).c_str(),
-             (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-             peer_.port);
+             GetSelfLabel()->c_str(),
+             GetTypeName(type_),
+             GetPeerLabel()->c_str());
   state_ = Socket::DISCONNECTED;
   state_lock.unlock();
   shared_ptr<HandlerDelegate> delegate = delegate_.lock();
@@ -469,25 +666,70 @@ void SocketImpl::OnDisconnect(const shared_ptr<SocketImpl>& socket) {
 
     }
   }
-  _DiscardMessages(socket);
+  state_lock.lock();
+  bool reconnect = (last_error_ != Error(LNR_OK)) && _ScheduleReconnect(socket);
+  state_lock.unlock();
+  _DiscardMessages(socket, reconnect);
   if (delegate && !handshaking_) {
     delegate->OnDisconnect(socket, last_error_);
   }
-  self_ = Addrinfo(); // reset self info
+  _ResetSelfInfo();
   return;
 }
 
-class _Response : public Message {
- public:
-  _Response() : Message(linear::RESPONSE), msgid(0) {}
-  ~_Response() {}
+// Decode helpers read each field of the unpacked [type, ...] array just once.
+// params and result take over the zone of the unpacked object instead of
+// being deep-copied, so a message body is never converted twice.
+static message_type_t DecodeType(const msgpack::object& obj) {
+  if (obj.type != msgpack::type::ARRAY || obj.via.array.size == 0) {
+    throw std::bad_cast();
+  }
+  return obj.via.array.ptr[0].as<message_type_t>();
+}
+
+static void DecodeRequest(msgpack::object_handle& handle, Request* request) {
+  const msgpack::object_array& array = handle.get().via.array;
+  if (array.size > 1) {
+    array.ptr[1].convert(request->msgid);
+  }
+  if (array.size > 2) {
+    array.ptr[2].convert(request->method);
+  }
+  if (array.size > 3) {
+    request->params.msgpack_adopt(array.ptr[3], handle.zone());
+  }
+}
+
+static void DecodeResponse(msgpack::object_handle& handle, Response* response) {
+  const msgpack::object_array& array = handle.get().via.array;
+  if (array.size > 1) {
+    array.ptr[1].convert(response->msgid);
+  }
+  if (array.size > 2) {
+    response->error = array.ptr[2]; // copied: the zone goes to result below
+  }
+  if (array.size > 3) {
+    response->result.msgpack_adopt(array.ptr[3], handle.zone());
+  }
+}
+
+static void DecodeNotify(msgpack::object_handle& handle, Notify* notify) {
+  const msgpack::object_array& array = handle.get().via.array;
+  if (array.size > 1) {
+    array.ptr[1].convert(notify->method);
+  }
+  if (array.size > 2) {
+    notify->params.msgpack_adopt(array.ptr[2], handle.zone());
+  }
+}
 
- public:
-  uint32_t msgid;
-  linear::type::any result;
-  linear::type::any error;
-  MSGPACK_DEFINE(type, msgid, error, result);
-};
+// str/bin/ext objects at least this large stay in the receive buffer
+// instead of being copied into the zone of the message.
+static const size_t RECV_REFERENCE_THRESHOLD = 1024;
+
+static bool ReferenceReceivedData(msgpack::type::object_type, size_t size, void*) {
+  return (size >= RECV_REFERENCE_THRESHOLD);
+}
 
 void SocketImpl::OnRead(const shared_ptr<SocketImpl>& socket, const tv_buf_t* buffer, ssize_t nread) {
   unique_lock<mutex> state_lock(state_mutex_);
@@ -508,123 +750,154 @@ void SocketImpl::OnRead(const shared_ptr<SocketImpl>& socket, const tv_buf_t* bu
 
   assert(nread != 0);
   if (nread <= 0) {
-    LINEAR_LOG(LOG_DEBUG, "%s(id = %d): %s:%d --- %s --x %s:%d",
+    LINEAR_LOG(LOG_DEBUG, "%s(id = %d): %s --- %s --x %s",
                tv_strerror(reinterpret_cast<tv_handle_t*>(stream_), nread),
                id_,
-               (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-               self_.port,
-               GetTypeString(type_).c_str(),
-               (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-               peer_.port);
+               GetSelfLabel()->c_str(),
+               GetTypeName(type_),
+               GetPeerLabel()->c_str());
     // error or EOF
     Disconnect(handshaking_);
     last_error_ = e;
     return;
   }
   // nread > 0
-  unpacker_.reserve_buffer(nread);
-  memcpy(unpacker_.buffer(), buffer->base, nread);
-  free(buffer->base);
-  unpacker_.buffer_consumed(nread);
+  _Count(StatsCounters::BYTES_IN, static_cast<size_t>(nread));
   shared_ptr<HandlerDelegate> delegate = delegate_.lock();
+  // libtv hands over a malloc'd buffer per read. While no partial message is
+  // pending in unpacker_, complete messages are parsed right where they landed
+  // and large str/bin/ext payloads keep pointing into the buffer, so only an
+  // incomplete tail has to be copied into unpacker_.
+  shared_ptr<char> received(buffer->base, free);
+  size_t length = static_cast<size_t>(nread);
   try {
     msgpack::object_handle result;
-    while (unpacker_.next(result)) {
-      msgpack::object obj = result.get();
-      Message message = obj.as<Message>();
-      switch(message.type) {
-      case REQUEST:
-        {
-          Request request = obj.as<Request>();
-          LINEAR_LOG(LOG_DEBUG, "recv request(id = %d): msgid = %u, method = \"%s\", params = %s, %s:%d <-- %s --- %s:%d",
-                     id_, request.msgid,
-                     request.method.c_str(), LINEAR_LOG_PRINTABLE_STRING(request.params).c_str(),
-                     (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-                     self_.port,
-                     GetTypeString(type_).c_str(),
-                     (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-                     peer_.port);
-          if (delegate) {
-            delegate->OnMessage(socket, request);
-          }
-        }
-        break;
-      case RESPONSE:
-        {
-          _Response _response = obj.as<_Response>();
-          LINEAR_LOG(LOG_DEBUG, "recv response(id = %d): msgid = %u, result = %s, error = %s, %s:%d <-- %s --- %s:%d",
-                     id_, _response.msgid,
-                     LINEAR_LOG_PRINTABLE_STRING(_response.result).c_str(),
-                     LINEAR_LOG_PRINTABLE_STRING(_response.error).c_str(),
-                     (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-                     self_.port,
-                     GetTypeString(type_).c_str(),
-                     (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-                     peer_.port);
-          unique_lock<mutex> request_timer_lock(request_timer_mutex_);
-          for (std::vector<SocketImpl::RequestTimer*>::iterator it = request_timers_.begin();
-               it != request_timers_.end(); it++) {
-            const Request& request = (*it)->request;
-            if (request.msgid == _response.msgid) {
-              Response response(_response.msgid, _response.result, _response.error, request);
-              delete *it;
-              request_timers_.erase(it);
-              request_timer_lock.unlock();
-              if (delegate) {
-                delegate->OnMessage(socket, response);
-              }
-              break;
-            }
-          }
-        }
-        break;
-      case NOTIFY:
-        {
-          Notify notify = obj.as<Notify>();
-          LINEAR_LOG(LOG_DEBUG, "recv notify(id = %d): method = \"%s\", params = %s, %s:%d <-- %s --- %s:%d",
-                     id_,
-                     notify.method.c_str(), LINEAR_LOG_PRINTABLE_STRING(notify.params).c_str(),
-                     (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-                     self_.port,
-                     GetTypeString(type_).c_str(),
-                     (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-                     peer_.port);
-          if (delegate) {
-            delegate->OnMessage(socket, notify);
+    size_t offset = 0;
+    if (unpacker_.nonparsed_size() == 0) {
+      size_t start = offset;
+      try {
+        while (offset < length) {
+          start = offset;
+          bool referenced = false;
+          msgpack::unpack(result, received.get(), length, offset, referenced, ReferenceReceivedData);
+          if (referenced) {
+            result.zone()->push_finalizer(msgpack::unique_ptr<shared_ptr<char> >(new shared_ptr<char>(received)));
           }
-          break;
+          _DispatchMessage(socket, delegate, result);
         }
-        break;
-      default:
-        throw std::bad_cast();
+      } catch (const msgpack::insufficient_bytes&) {
+        // unpack has moved offset into the partial message before throwing:
+        // the rest is parsed by unpacker_ from its head once it is complete
+        offset = start;
+      }
+    }
+    if (offset < length) {
+      unpacker_.reserve_buffer(length - offset);
+      memcpy(unpacker_.buffer(), received.get() + offset, length - offset);
+      unpacker_.buffer_consumed(length - offset);
+      while (unpacker_.next(result)) {
+        _DispatchMessage(socket, delegate, result);
       }
     }
     if (unpacker_.message_size() > max_recv_buffer_size_) {
       throw std::runtime_error("");
     }
   } catch (const std::bad_cast&) {
-    LINEAR_LOG(LOG_WARN, "recv invalid message(id = %d): %s:%d <-- %s -- %s:%d",
+    _Count(StatsCounters::DECODE_ERRORS, 1);
+    LINEAR_LOG(LOG_WARN, "recv invalid message(id = %d): %s <-- %s -- %s",
                id_,
-               (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-               self_.port,
-               GetTypeString(type_).c_str(),
-               (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-               peer_.port);
+               GetSelfLabel()->c_str(),
+               GetTypeName(type_),
+               GetPeerLabel()->c_str());
     Disconnect();
   } catch (...) {
-    LINEAR_LOG(LOG_ERR, "recv malformed or big message(id = %d): %s:%d <-- %s -- %s:%d",
+    _Count(StatsCounters::DECODE_ERRORS, 1);
+    LINEAR_LOG(LOG_ERR, "recv malformed or big message(id = %d): %s <-- %s -- %s",
                id_,
-               (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-               self_.port,
-               GetTypeString(type_).c_str(),
-               (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-               peer_.port);
+               GetSelfLabel()->c_str(),
+               GetTypeName(type_),
+               GetPeerLabel()->c_str());
     Disconnect();
   }
 }
 
+void SocketImpl::_DispatchMessage(const shared_ptr<SocketImpl>& socket,
+                                  const shared_ptr<HandlerDelegate>& delegate,
+                                  msgpack::object_handle& handle) {
+  message_type_t type = DecodeType(handle.get());
+  _Count(StatsCounters::MESSAGES_IN, 1);
+  switch(type) {
+  case REQUEST:
+    {
+      Request request;
+      DecodeRequest(handle, &request);
+      LINEAR_LOG(LOG_DEBUG, "recv request(id = %d): msgid = %u, method = \"%s\", params = %s, %s <-- %s --- %s",
+                 id_, request.msgid,
+                 request.method.c_str(), LINEAR_LOG_PRINTABLE_STRING(request.params).c_str(),
+                 GetSelfLabel()->c_str(),
+                 GetTypeName(type_),
+                 GetPeerLabel()->c_str());
+      if (delegate) {
+        delegate->OnMessage(socket, request);
+      }
+    }
+    break;
+  case RESPONSE:
+    {
+      Response response;
+      DecodeResponse(handle, &response);
+      LINEAR_LOG(LOG_DEBUG, "recv response(id = %d): msgid = %u, result = %s, error = %s, %s <-- %s --- %s",
+                 id_, response.msgid,
+                 LINEAR_LOG_PRINTABLE_STRING(response.result).c_str(),
+                 LINEAR_LOG_PRINTABLE_STRING(response.error).c_str(),
+                 GetSelfLabel()->c_str(),
+                 GetTypeName(type_),
+                 GetPeerLabel()->c_str());
+      RequestTimer* request_timer = request_timers_.Remove(response.msgid);
+      if (request_timer != NULL) {
+        _Uncount(StatsCounters::OUTSTANDING_REQUESTS, 1);
+        _NotifyRequestDone(response.msgid,
+                           response.error.is_nil() ? RequestObserver::SUCCEEDED : RequestObserver::FAILED);
+        if (delegate && delegate->GetLatencyRecorder()->IsEnabled()) {
+          delegate->GetLatencyRecorder()->RecordRoundTrip(request_timer->request.method,
+                                                          (uv_hrtime() - request_timer->sent_at) / 1000);
+        }
+#if !defined(MSGPACK_USE_CPP03)
+        response.request = std::move(request_timer->request);
+#else
+        response.request = request_timer->request;
+#endif
+        delete request_timer;
+        if (delegate) {
+          delegate->OnMessage(socket, response);
+        }
+      }
+    }
+    break;
+  case NOTIFY:
+    {
+      Notify notify;
+      DecodeNotify(handle, &notify);
+      LINEAR_LOG(LOG_DEBUG, "recv notify(id = %d): method = \"%s\", params = %s, %s <-- %s --- %s",
+                 id_,
+                 notify.method.c_str(), LINEAR_LOG_PRINTABLE_STRING(notify.params).c_str(),
+                 GetSelfLabel()->c_str(),
+                 GetTypeName(type_),
+                 GetPeerLabel()->c_str());
+      if (delegate) {
+        delegate->OnMessage(socket, notify);
+      }
+      break;
+    }
+    break;
+  default:
+    throw std::bad_cast();
+  }
+}
+
 void SocketImpl::OnWrite(const shared_ptr<SocketImpl>& socket, const Message* message, int status) {
   assert(message != NULL);
+  _Uncount(StatsCounters::SEND_QUEUE_DEPTH, 1);
   if (status) {
     LINEAR_LOG(LOG_ERR, "fail to send message(id = %d): %s",
                id_,
@@ -634,16 +907,11 @@ void SocketImpl::OnWrite(const shared_ptr<SocketImpl>& socket, const Message* me
       case REQUEST:
 	{
 	  linear::Request request_fail = *(static_cast<const Request*>(message));
-	  unique_lock<mutex> request_timer_lock(request_timer_mutex_);
-	  for (std::vector<SocketImpl::RequestTimer*>::iterator it = request_timers_.begin();
-	       it != request_timers_.end(); it++) {
-	    const Request& request = (*it)->request;
-	    if (request.msgid == request_fail.msgid) {
-	      delete *it;
-	      request_timers_.erase(it);
-	      request_timer_lock.unlock();
-	      break;
-	    }
+	  RequestTimer* request_timer = request_timers_.Remove(request_fail.msgid);
+	  if (request_timer != NULL) {
+	    _Uncount(StatsCounters::OUTSTANDING_REQUESTS, 1);
+	    _NotifyRequestDone(request_fail.msgid, RequestObserver::FAILED);
+	    delete request_timer;
 	  }
 	  delegate->OnError(socket, request_fail, Error(status));
 	}
@@ -666,43 +934,72 @@ void SocketImpl::OnConnectTimeout(const shared_ptr<SocketImpl>& socket) {
   OnConnect(socket, stream_, TV_ETIMEDOUT);
 }
 
-void SocketImpl::OnRequestTimeout(const shared_ptr<SocketImpl>& socket, const Request& request) {
-  unique_lock<mutex> request_timer_lock(request_timer_mutex_);
-  for (std::vector<SocketImpl::RequestTimer*>::iterator it = request_timers_.begin();
-       it != request_timers_.end(); it++) {
-    const Request& ref = (*it)->request;
-    if (ref.msgid == request.msgid) {
-      LINEAR_LOG(LOG_INFO, "occur request timeout(id = %d): msgid = %d",
-                 id_, request.msgid);
-      request_timers_.erase(it);
-      break;
+void SocketImpl::OnReconnect(const shared_ptr<SocketImpl>& socket) {
+  unique_lock<mutex> state_lock(state_mutex_);
+  if (!reconnecting_) {
+    if (state_ == Socket::DISCONNECTED) { // stopped while waiting
+      std::vector<Outgoing> outbox;
+      outbox.swap(pending_messages_);
+      _UpdateQueueDepth();
+      state_lock.unlock();
+      _CancelMessages(socket, outbox, Error(LNR_ECANCELED));
     }
+    return;
+  }
+  state_lock.unlock();
+  Error err(LNR_ENOMEM);
+  try {
+    EventLoopImpl::SocketEvent* ev = new EventLoopImpl::SocketEvent(socket);
+    err = Connect(connect_timeout_, ev);
+    if (err != Error(LNR_OK)) {
+      delete ev;
+    }
+  } catch(...) {
+    LINEAR_LOG(LOG_ERR, "no memory");
+  }
+  state_lock.lock();
+  if (err == Error(LNR_OK) || !reconnecting_ || _ScheduleReconnect(socket)) {
+    return;
+  }
+  // give up
+  reconnecting_ = false;
+  std::vector<Outgoing> outbox;
+  outbox.swap(pending_messages_);
+  _UpdateQueueDepth();
+  state_lock.unlock();
+  _CancelMessages(socket, outbox, Error(LNR_ECANCELED));
+}
+
+void SocketImpl::OnRequestTimeout(const shared_ptr<SocketImpl>& socket, RequestTimer* request_timer) {
+  if (!request_timers_.Remove(request_timer)) {
+    return;
   }
-  request_timer_lock.unlock();
+  _Uncount(StatsCounters::OUTSTANDING_REQUESTS, 1);
+  _Count(StatsCounters::TIMEOUTS, 1);
+  _NotifyRequestDone(request_timer->request.msgid, RequestObserver::FAILED);
+  LINEAR_LOG(LOG_INFO, "occur request timeout(id = %d): msgid = %d",
+             id_, request_timer->request.msgid);
   if (shared_ptr<HandlerDelegate> delegate = delegate_.lock()) {
-    delegate->OnError(socket, request, Error(LNR_ETIMEDOUT));
+    delegate->OnError(socket, request_timer->request, Error(LNR_ETIMEDOUT));
   }
+  delete request_timer;
 }
 
-Error SocketImpl::_Send(Message* message) {
-  assert(message != NULL);
-  RequestTimer* request_timer = NULL;
-  msgpack::sbuffer sbuf;
+Error SocketImpl::_Pack(Message* message, WriteBuffer* wbuf, RequestTimer** request_timer) {
+  assert(message != NULL && wbuf != NULL && request_timer != NULL);
   switch(message->type) {
   case REQUEST:
     {
       const Request* request = static_cast<const Request*>(message);
-      LINEAR_LOG(LOG_DEBUG, "send request(id = %d): msgid = %u, method = \"%s\", params = %s, %s:%d --- %s --> %s:%d",
+      LINEAR_LOG(LOG_DEBUG, "send request(id = %d): msgid = %u, method = \"%s\", params = %s, %s --- %s --> %s",
                  id_,
                  request->msgid, request->method.c_str(), LINEAR_LOG_PRINTABLE_STRING(request->params).c_str(),
-                 (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-                 self_.port,
-                 GetTypeString(type_).c_str(),
-                 (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-                 peer_.port);
-      msgpack::pack(sbuf, *request);
+                 GetSelfLabel()->c_str(),
+                 GetTypeName(type_),
+                 GetPeerLabel()->c_str());
+      msgpack::pack(*wbuf, *request);
       try {
-	request_timer = new RequestTimer(*request, ev_->socket, loop_);
+	*request_timer = new RequestTimer(*request, ev_->socket, loop_);
       } catch(...) {
 	Error err(LNR_ENOMEM);
 	LINEAR_LOG(LOG_ERR, "fail to send message(id = %d): %s",
@@ -714,162 +1011,509 @@ Error SocketImpl::_Send(Message* message) {
   case RESPONSE:
     {
       const Response* response = static_cast<const Response*>(message);
-      LINEAR_LOG(LOG_DEBUG, "send response(id = %d): msgid = %u, result = %s, error = %s, %s:%d --- %s --> %s:%d",
+      LINEAR_LOG(LOG_DEBUG, "send response(id = %d): msgid = %u, result = %s, error = %s, %s --- %s --> %s",
                  id_,
                  response->msgid,
                  LINEAR_LOG_PRINTABLE_STRING(response->result).c_str(),
                  LINEAR_LOG_PRINTABLE_STRING(response->error).c_str(),
-                 (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-                 self_.port,
-                 GetTypeString(type_).c_str(),
-                 (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-                 peer_.port);
-      msgpack::pack(sbuf, *response);
+                 GetSelfLabel()->c_str(),
+                 GetTypeName(type_),
+                 GetPeerLabel()->c_str());
+      msgpack::pack(*wbuf, *response);
       break;
     }
   case NOTIFY:
     {
       const Notify* notify = static_cast<const Notify*>(message);
-      LINEAR_LOG(LOG_DEBUG, "send notify(id = %d): method = \"%s\", params = %s, %s:%d --- %s --> %s:%d",
+      LINEAR_LOG(LOG_DEBUG, "send notify(id = %d): method = \"%s\", params = %s, %s --- %s --> %s",
                  id_,
                  notify->method.c_str(), LINEAR_LOG_PRINTABLE_STRING(notify->params).c_str(),
-                 (self_.proto == Addrinfo::IPv4) ? self_.addr.c_str() : (std::string("[" + self_.addr + "]")).c_str(),
-                 self_.port,
-                 GetTypeString(type_).c_str(),
-                 (peer_.proto == Addrinfo::IPv4) ? peer_.addr.c_str() : (std::string("[" + peer_.addr + "]")).c_str(),
-                 peer_.port);
-      msgpack::pack(sbuf, *notify);
+                 GetSelfLabel()->c_str(),
+                 GetTypeName(type_),
+                 GetPeerLabel()->c_str());
+      msgpack::pack(*wbuf, *notify);
       break;
     }
   default:
     LINEAR_LOG(LOG_ERR, "invalid type of message: %d", message->type);
     return Error(LNR_EINVAL);
   }
-  char* copy_data = static_cast<char*>(malloc(sbuf.size()));
-  if (copy_data == NULL) {
-    Error err(LNR_ENOMEM);
-    LINEAR_LOG(LOG_ERR, "fail to send message(id = %d): %s",
-               id_, err.Message().c_str());
-    if (request_timer != NULL) {
-      delete request_timer;
+  return Error(LNR_OK);
+}
+
+// takes ownership of entry.message
+Error SocketImpl::_Queue(const Outgoing& entry) {
+  if (reconnecting_ && state_ == Socket::DISCONNECTED && _GetMessage(entry).type != NOTIFY) {
+    delete entry.message;
+    return Error(LNR_ENOTCONN);
+  }
+  if (state_ == Socket::CONNECTING || state_ == Socket::DISCONNECTED) {
+    if (reconnect_enabled_ && pending_messages_.size() >= reconnect_policy_.max_outbox) {
+      LINEAR_LOG(LOG_WARN, "fail to send message(id = %d): outbox is full", id_);
+      delete entry.message;
+      return Error(LNR_ENOBUFS);
+    }
+    try {
+      pending_messages_.push_back(entry);
+    } catch(...) {
+      delete entry.message;
+      throw;
     }
+    _UpdateQueueDepth();
+    return Error(LNR_OK);
+  }
+  Error err(LNR_ENOMEM);
+  try {
+    err = _Send(entry);
+  } catch(...) {
+    delete entry.message;
+    throw;
+  }
+  if (err != Error(LNR_OK)) {
+    delete entry.message;
+  }
+  return err;
+}
+
+Error SocketImpl::_Send(const Outgoing& entry) {
+  assert(entry.message != NULL || entry.buffer);
+  // keep the order of messages corked before coalescing is disabled
+  if (!write_coalescing_ && corked_messages_.empty()) {
+    return _Write(entry);
+  }
+  corked_messages_.push_back(entry);
+  if (corked_messages_.size() == 1) {
+    Error err = flush_timer_.Start(EventLoopImpl::OnFlush, 0, ev_);
+    if (err != Error(LNR_OK)) {
+      corked_messages_.pop_back();
+      LINEAR_LOG(LOG_ERR, "fail to send message(id = %d): %s",
+                 id_, err.Message().c_str());
+      return err;
+    }
+  }
+  _UpdateQueueDepth();
+  return Error(LNR_OK);
+}
+
+const Message& SocketImpl::_GetMessage(const Outgoing& entry) {
+  return (entry.buffer) ? entry.buffer->GetMessage() : *entry.message;
+}
+
+Error SocketImpl::_Write(const Outgoing& entry) {
+  if (entry.buffer) {
+    return _Write(entry.buffer, entry.timeout);
+  }
+  return _Write(entry.message);
+}
+
+Error SocketImpl::_Write(Message* message) {
+  RequestTimer* request_timer = NULL;
+  WriteBuffer wbuf;
+  Error err = _Pack(message, &wbuf, &request_timer);
+  if (err != Error(LNR_OK)) {
     return err;
   }
-  memcpy(copy_data, sbuf.data(), sbuf.size());
-  tv_buf_t buffer = static_cast<tv_buf_t>(uv_buf_init(copy_data, sbuf.size()));
-  tv_write_t* w = static_cast<tv_write_t*>(malloc(sizeof(tv_write_t)));
+  tv_buf_t buffer;
+  tv_write_t* w = wbuf.Release(&buffer);
   if (w == NULL) {
-    Error err(LNR_ENOMEM);
+    err = Error(LNR_ENOMEM);
     LINEAR_LOG(LOG_ERR, "fail to send message(id = %d): %s",
                id_, err.Message().c_str());
-    free(copy_data);
     if (request_timer != NULL) {
       delete request_timer;
     }
     return err;
   }
+  if (request_timer != NULL) {
+    err = _StartRequestTimer(request_timer);
+    if (err != Error(LNR_OK)) {
+      free(w);
+      delete request_timer;
+      return err;
+    }
+  }
   w->data = message;
   int ret = tv_write(w, stream_, buffer, EventLoopImpl::OnWrite);
   if (ret) { // EINVAL or ENOMEM
-    Error err(ret);
+    err = Error(ret);
     free(w);
-    free(copy_data);
+    if (request_timer != NULL) {
+      _StopRequestTimer(request_timer);
+    }
+    LINEAR_LOG(LOG_ERR, "fail to send message(id = %d): %s",
+               id_, err.Message().c_str());
+    return err;
+  }
+  _Count(StatsCounters::BYTES_OUT, buffer.len);
+  _Count(StatsCounters::MESSAGES_OUT, 1);
+  _Count(StatsCounters::SEND_QUEUE_DEPTH, 1);
+  return Error(LNR_OK);
+}
+
+Error SocketImpl::_Write(const shared_ptr<const SharedBuffer>& buffer, int timeout) {
+  const Message& message = buffer->GetMessage();
+  LINEAR_LOG(LOG_DEBUG, "send packed message(id = %d): type = %d, %s --- %s --> %s",
+             id_, message.type,
+             GetSelfLabel()->c_str(),
+             GetTypeName(type_),
+             GetPeerLabel()->c_str());
+  RequestTimer* request_timer = NULL;
+  SharedWriteRequest* shared = NULL;
+  try {
+    if (message.type == REQUEST) {
+      request_timer = new RequestTimer(static_cast<const Request&>(message), ev_->socket, loop_);
+      request_timer->request.timeout_ = timeout;
+    }
+    shared = new SharedWriteRequest(buffer);
+  } catch(...) {
     if (request_timer != NULL) {
       delete request_timer;
     }
+    Error err(LNR_ENOMEM);
     LINEAR_LOG(LOG_ERR, "fail to send message(id = %d): %s",
                id_, err.Message().c_str());
     return err;
   }
   if (request_timer != NULL) {
-    unique_lock<mutex> request_timer_lock(request_timer_mutex_);
-    request_timers_.push_back(request_timer);
-    request_timer_lock.unlock();
-    request_timer->Start();
+    Error err = _StartRequestTimer(request_timer);
+    if (err != Error(LNR_OK)) {
+      delete shared;
+      delete request_timer;
+      return err;
+    }
+  }
+  tv_buf_t buf = static_cast<tv_buf_t>(uv_buf_init(const_cast<char*>(buffer->data()), buffer->size()));
+  shared->write.data = shared;
+  int ret = tv_write(&shared->write, stream_, buf, EventLoopImpl::OnSharedWrite);
+  if (ret) { // EINVAL or ENOMEM
+    Error err(ret);
+    delete shared;
+    if (request_timer != NULL) {
+      _StopRequestTimer(request_timer);
+    }
+    LINEAR_LOG(LOG_ERR, "fail to send message(id = %d): %s",
+               id_, err.Message().c_str());
+    return err;
   }
+  _Count(StatsCounters::BYTES_OUT, buffer->size());
+  _Count(StatsCounters::MESSAGES_OUT, 1);
+  _Count(StatsCounters::SEND_QUEUE_DEPTH, 1);
   return Error(LNR_OK);
 }
 
-void SocketImpl::_SendPendingMessages(const shared_ptr<SocketImpl>& socket) {
-  unique_lock<mutex> state_lock(state_mutex_);
-  // Send pending messages
-  std::vector<Message*> fail_to_send;
-  for (std::vector<Message*>::iterator it = pending_messages_.begin();
-       it != pending_messages_.end(); it++) {
-    if (state_ != Socket::CONNECTED) {
-      fail_to_send.push_back(*it);
-    } else {
-      Error err = _Send(*it);
+// shared buffers are written as they are, and the owned messages between
+// them are packed into one buffer, so that the order is kept
+Error SocketImpl::_Write(const std::vector<Outgoing>& entries, std::vector<Outgoing>* fail_to_send) {
+  Error result(LNR_OK);
+  std::vector<Message*> messages;
+  for (std::vector<Outgoing>::const_iterator it = entries.begin(); it != entries.end(); it++) {
+    if (!it->buffer) {
+      messages.push_back(it->message);
+      continue;
+    }
+    if (!messages.empty()) {
+      Error err = _Write(messages, fail_to_send);
+      if (result == Error(LNR_OK)) {
+        result = err;
+      }
+      messages.clear();
+    }
+    Error err = _Write(it->buffer, it->timeout);
+    if (err != Error(LNR_OK)) {
+      fail_to_send->push_back(*it);
+      if (result == Error(LNR_OK)) {
+        result = err;
+      }
+    }
+  }
+  if (!messages.empty()) {
+    Error err = _Write(messages, fail_to_send);
+    if (result == Error(LNR_OK)) {
+      result = err;
+    }
+  }
+  return result;
+}
+
+Error SocketImpl::_Write(const std::vector<Message*>& messages, std::vector<Outgoing>* fail_to_send) {
+  if (messages.size() == 1) {
+    Error err = _Write(messages[0]);
+    if (err != Error(LNR_OK)) {
+      fail_to_send->push_back(Outgoing(messages[0]));
+    }
+    return err;
+  }
+  // tv_write takes one buffer, so messages are packed back to back
+  WriteBuffer wbuf;
+  std::vector<Message*>* batch = new std::vector<Message*>();
+  std::vector<RequestTimer*> request_timers;
+  batch->reserve(messages.size());
+  for (std::vector<Message*>::const_iterator it = messages.begin(); it != messages.end(); it++) {
+    RequestTimer* request_timer = NULL;
+    if (_Pack(*it, &wbuf, &request_timer) != Error(LNR_OK)) {
+      fail_to_send->push_back(Outgoing(*it));
+      continue;
+    }
+    batch->push_back(*it);
+    if (request_timer != NULL) {
+      request_timers.push_back(request_timer);
+    }
+  }
+  Error err(LNR_OK);
+  tv_buf_t buffer;
+  tv_write_t* w = wbuf.Release(&buffer);
+  std::vector<RequestTimer*>::iterator started = request_timers.begin();
+  if (w == NULL) {
+    err = Error(batch->empty() ? LNR_EINVAL : LNR_ENOMEM);
+  } else {
+    for (; started != request_timers.end(); started++) {
+      err = _StartRequestTimer(*started);
       if (err != Error(LNR_OK)) {
-        fail_to_send.push_back(*it);
+        break;
+      }
+    }
+    if (err == Error(LNR_OK)) {
+      w->data = batch;
+      int ret = tv_write(w, stream_, buffer, EventLoopImpl::OnBatchWrite);
+      if (ret) { // EINVAL or ENOMEM
+        err = Error(ret);
       }
     }
+    if (err != Error(LNR_OK)) {
+      free(w);
+    }
+  }
+  if (err != Error(LNR_OK)) {
+    LINEAR_LOG(LOG_ERR, "fail to send messages(id = %d): %s",
+               id_, err.Message().c_str());
+    for (std::vector<Message*>::iterator it = batch->begin(); it != batch->end(); it++) {
+      fail_to_send->push_back(Outgoing(*it));
+    }
+    delete batch;
+    for (std::vector<RequestTimer*>::iterator it = request_timers.begin(); it != started; it++) {
+      _StopRequestTimer(*it);
+    }
+    for (std::vector<RequestTimer*>::iterator it = started; it != request_timers.end(); it++) {
+      delete *it;
+    }
+    return err;
+  }
+  _Count(StatsCounters::BYTES_OUT, buffer.len);
+  _Count(StatsCounters::MESSAGES_OUT, batch->size());
+  _Count(StatsCounters::SEND_QUEUE_DEPTH, batch->size());
+  return err;
+}
+
+Error SocketImpl::_StartRequestTimer(RequestTimer* request_timer) {
+  _Count(StatsCounters::OUTSTANDING_REQUESTS, 1);
+  request_timers_.Add(request_timer);
+  Error err = request_timer->Start();
+  if (err != Error(LNR_OK)) {
+    request_timers_.Remove(request_timer);
+    _Uncount(StatsCounters::OUTSTANDING_REQUESTS, 1);
+    LINEAR_LOG(LOG_ERR, "fail to start request timer(id = %d): %s",
+               id_, err.Message().c_str());
+  }
+  return err;
+}
+
+void SocketImpl::_StopRequestTimer(RequestTimer* request_timer) {
+  if (request_timers_.Remove(request_timer)) {
+    _Uncount(StatsCounters::OUTSTANDING_REQUESTS, 1);
+    delete request_timer;
+  }
+}
+
+void SocketImpl::OnFlush(const shared_ptr<SocketImpl>& socket) {
+  unique_lock<mutex> state_lock(state_mutex_);
+  std::vector<Outgoing> messages;
+  messages.swap(corked_messages_);
+  _UpdateQueueDepth();
+  std::vector<Outgoing> fail_to_send;
+  if (state_ != Socket::CONNECTED) {
+    fail_to_send.swap(messages);
+  } else if (!messages.empty()) {
+    _Write(messages, &fail_to_send);
   }
-  std::vector<Message*>().swap(pending_messages_);
+  state_lock.unlock();
+  _CancelMessages(socket, fail_to_send, Error(LNR_ECANCELED));
+}
+
+void SocketImpl::_SendPendingMessages(const shared_ptr<SocketImpl>& socket) {
+  unique_lock<mutex> state_lock(state_mutex_);
+  // Send pending messages at once
+  std::vector<Outgoing> fail_to_send;
+  if (state_ != Socket::CONNECTED) {
+    fail_to_send.swap(pending_messages_);
+  } else if (!pending_messages_.empty()) {
+    _Write(pending_messages_, &fail_to_send);
+  }
+  std::vector<Outgoing>().swap(pending_messages_);
+  _UpdateQueueDepth();
   state_lock.unlock();
   // call OnError when fail to send pending messages
-  Error pending_err = Error(LNR_ECANCELED);
+  _CancelMessages(socket, fail_to_send, Error(LNR_ECANCELED));
+}
+
+// keep_notifies: notifies stay in pending_messages_ as the outbox of reconnect
+void SocketImpl::_DiscardMessages(const shared_ptr<SocketImpl>& socket, bool keep_notifies) {
+  Error err = Error(LNR_ECANCELED);
+  unique_lock<mutex> state_lock(state_mutex_);
+  flush_timer_.Stop();
+  std::vector<Outgoing> messages;
+  messages.swap(pending_messages_);
+  messages.insert(messages.end(), corked_messages_.begin(), corked_messages_.end());
+  std::vector<Outgoing>().swap(corked_messages_);
+  std::vector<Outgoing> fail_to_send;
+  for (std::vector<Outgoing>::iterator it = messages.begin(); it != messages.end(); it++) {
+    if (keep_notifies && _GetMessage(*it).type == NOTIFY && pending_messages_.size() < reconnect_policy_.max_outbox) {
+      pending_messages_.push_back(*it);
+    } else {
+      fail_to_send.push_back(*it);
+    }
+  }
+  _UpdateQueueDepth();
+  state_lock.unlock();
+  _CancelMessages(socket, fail_to_send, err);
+
   shared_ptr<HandlerDelegate> delegate = delegate_.lock();
-  for (std::vector<Message*>::iterator it = fail_to_send.begin();
-       it != fail_to_send.end(); it++) {
-    Message* message = *it;
+  std::vector<RequestTimer*> cancelled_requests;
+  request_timers_.RemoveAll(&cancelled_requests);
+  _Uncount(StatsCounters::OUTSTANDING_REQUESTS, cancelled_requests.size());
+  for (std::vector<RequestTimer*>::iterator it = cancelled_requests.begin();
+       it != cancelled_requests.end(); it++) {
+    _NotifyRequestDone((*it)->request.msgid, RequestObserver::CANCELLED);
     if (delegate) {
-      switch(message->type) {
-      case REQUEST:
-        delegate->OnError(socket, *(static_cast<Request*>(message)), pending_err);
-        break;
-      case RESPONSE:
-        delegate->OnError(socket, *(static_cast<Response*>(message)), pending_err);
-        break;
-      case NOTIFY:
-        delegate->OnError(socket, *(static_cast<Notify*>(message)), pending_err);
-        break;
-      default:
-        LINEAR_LOG(LOG_ERR, "BUG: invalid type of message");
-        assert(false);
+      delegate->OnError(socket, (*it)->request, err);
+    }
+    delete *it;
+  }
+}
+
+bool SocketImpl::_ScheduleReconnect(const shared_ptr<SocketImpl>& socket) {
+  if (!reconnect_enabled_ || !connectable_) {
+    return false;
+  }
+  if (reconnect_policy_.max_attempts > 0 && reconnect_attempts_ >= reconnect_policy_.max_attempts) {
+    LINEAR_LOG(LOG_WARN, "give up reconnecting(id = %d) after %u attempts", id_, reconnect_attempts_);
+    reconnect_attempts_ = 0;
+    return false;
+  }
+  // exponential backoff with jitter, so that clients of a restarted server do not come back at once
+  uint64_t delay = reconnect_policy_.initial_delay;
+  for (unsigned int i = 0; i < reconnect_attempts_ && delay < reconnect_policy_.max_delay; i++) {
+    delay *= 2;
+  }
+  if (delay > reconnect_policy_.max_delay) {
+    delay = reconnect_policy_.max_delay;
+  }
+  reconnect_random_ ^= reconnect_random_ << 13; // xorshift32
+  reconnect_random_ ^= reconnect_random_ >> 17;
+  reconnect_random_ ^= reconnect_random_ << 5;
+  delay -= static_cast<uint64_t>(static_cast<double>(delay) * reconnect_policy_.jitter *
+                                 (static_cast<double>(reconnect_random_) / 4294967296.0));
+  try {
+    if (reconnect_ev_ == NULL) {
+      reconnect_ev_ = new EventLoopImpl::SocketEvent(socket);
+    }
+  } catch(...) {
+    LINEAR_LOG(LOG_ERR, "no memory");
+    return false;
+  }
+  Error err = reconnect_timer_.Start(EventLoopImpl::OnReconnect, static_cast<unsigned int>(delay), reconnect_ev_);
+  if (err != Error(LNR_OK)) {
+    LINEAR_LOG(LOG_ERR, "fail to reconnect(id = %d): %s", id_, err.Message().c_str());
+    return false;
+  }
+  reconnect_attempts_++;
+  reconnecting_ = true;
+  LINEAR_LOG(LOG_INFO, "reconnect(id = %d) in %u msec: attempt %u",
+             id_, static_cast<unsigned int>(delay), reconnect_attempts_);
+  return true;
+}
+
+void SocketImpl::_UpdateQueueDepth() {
+  size_t queued = pending_messages_.size() + corked_messages_.size();
+  if (queued > queued_) {
+    _Count(StatsCounters::SEND_QUEUE_DEPTH, queued - queued_);
+  } else if (queued < queued_) {
+    _Uncount(StatsCounters::SEND_QUEUE_DEPTH, queued_ - queued);
+  }
+  queued_ = queued;
+}
+
+// getnameinfo is deferred until the address is read:
+// most accepted sockets are never asked for it
+void SocketImpl::_SetSelfInfo(const struct sockaddr* sa) {
+  lock_guard<mutex> info_lock(info_mutex_);
+  memcpy(&self_addr_.ss, sa, (sa->sa_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in));
+  self_pending_ = true;
+  self_label_.reset();
+}
+
+void SocketImpl::_SetPeerInfo(const struct sockaddr* sa) {
+  lock_guard<mutex> info_lock(info_mutex_);
+  memcpy(&peer_addr_.ss, sa, (sa->sa_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in));
+  peer_pending_ = true;
+  peer_label_.reset();
+}
+
+void SocketImpl::_ResetSelfInfo() {
+  lock_guard<mutex> info_lock(info_mutex_);
+  self_ = Addrinfo();
+  self_pending_ = false;
+  self_label_.reset();
+}
+
+void SocketImpl::_NotifyRequestDone(uint32_t msgid, RequestObserver::Outcome outcome) {
+  if (atomic::LoadRelaxed(&observed_) == 0) {
+    return;
+  }
+  std::vector<shared_ptr<RequestObserver> > observers;
+  {
+    lock_guard<mutex> lock(observers_mutex_);
+    std::vector<weak_ptr<RequestObserver> >::iterator it = observers_.begin();
+    while (it != observers_.end()) {
+      if (shared_ptr<RequestObserver> observer = it->lock()) {
+        observers.push_back(observer);
+        it++;
+      } else {
+        it = observers_.erase(it);
       }
     }
-    delete message;
+    atomic::StoreRelaxed(&observed_, observers_.size());
+  }
+  for (std::vector<shared_ptr<RequestObserver> >::iterator it = observers.begin(); it != observers.end(); it++) {
+    (*it)->OnRequestDone(id_, msgid, outcome);
   }
 }
 
-void SocketImpl::_DiscardMessages(const shared_ptr<SocketImpl>& socket) {
-  Error err = Error(LNR_ECANCELED);
+void SocketImpl::_CancelMessages(const shared_ptr<SocketImpl>& socket,
+                                 const std::vector<Outgoing>& entries, const Error& err) {
   shared_ptr<HandlerDelegate> delegate = delegate_.lock();
-  std::vector<Message*> fail_to_send;
-  fail_to_send.swap(pending_messages_);
-  for (std::vector<Message*>::iterator it = fail_to_send.begin();
-       it != fail_to_send.end(); it++) {
-    Message* message = *it;
+  for (std::vector<Outgoing>::const_iterator it = entries.begin();
+       it != entries.end(); it++) {
+    const Message& message = _GetMessage(*it);
+    if (message.type == REQUEST) {
+      _NotifyRequestDone(static_cast<const Request&>(message).msgid, RequestObserver::CANCELLED);
+    }
     if (delegate) {
-      switch(message->type) {
+      switch(message.type) {
       case REQUEST:
-        delegate->OnError(socket, *(static_cast<Request*>(message)), err);
+        delegate->OnError(socket, static_cast<const Request&>(message), err);
         break;
       case RESPONSE:
-        delegate->OnError(socket, *(static_cast<Response*>(message)), err);
+        delegate->OnError(socket, static_cast<const Response&>(message), err);
         break;
       case NOTIFY:
-        delegate->OnError(socket, *(static_cast<Notify*>(message)), err);
+        delegate->OnError(socket, static_cast<const Notify&>(message), err);
         break;
       default:
         LINEAR_LOG(LOG_ERR, "BUG: invalid type of message");
         assert(false);
       }
     }
-    delete message;
-  }
-
-  std::vector<RequestTimer*> cancelled_requests;
-  unique_lock<mutex> request_timer_lock(request_timer_mutex_);
-  cancelled_requests.swap(request_timers_);
-  request_timer_lock.unlock();
-  for (std::vector<RequestTimer*>::iterator it = cancelled_requests.begin();
-       it != cancelled_requests.end(); it++) {
-    if (delegate) {
-      delegate->OnError(socket, (*it)->request, err);
-    }
-    delete *it;
+    delete it->message;
   }
 }
 
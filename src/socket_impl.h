@@ -6,33 +6,52 @@
 #include "linear/timer.h"
 
 #include "event_loop_impl.h"
+#include "request_pool.h"
+#include "stats_counters.h"
+#include "timer_wheel.h"
 
 namespace linear {
 
 class HandlerDelegate;
+class SharedBuffer;
+class WriteBuffer;
 
 class SocketImpl {
  public:
-  class RequestTimer {
+  class RequestTimer : public linear::TimerWheel::Entry {
    public:
     RequestTimer(const linear::Request& r, const linear::weak_ptr<linear::SocketImpl> s,
                  const linear::shared_ptr<linear::EventLoopImpl> l)
-      : request(r), socket(s), timer(l) {}
+      : request(r), socket(s), wheel(l->GetTimerWheel()), sent_at(uv_hrtime()) {}
     ~RequestTimer() {
       Stop();
     }
-    void Start() {
-      timer.Start(linear::EventLoopImpl::OnRequestTimeout, static_cast<uint64_t>(request.timeout_), this);
+    linear::Error Start() {
+      return wheel->Add(this, linear::EventLoopImpl::OnRequestTimeout, static_cast<unsigned int>(request.timeout_), this);
     }
     void Stop() {
-      timer.Stop();
+      wheel->Remove(this);
     }
    public:
     linear::Request request;
     linear::weak_ptr<linear::SocketImpl> socket;
-    linear::Timer timer;
+    linear::shared_ptr<linear::TimerWheel> wheel;
+    uint64_t sent_at; // nsec, for the round trip time
   };
-  
+
+  // told how each request written to the socket ends, e.g. by ClientPool.
+  // called on the event loop thread
+  class RequestObserver {
+   public:
+    enum Outcome {
+      SUCCEEDED, // response without error
+      FAILED,    // error response, timeout or write error
+      CANCELLED  // disconnected before the response
+    };
+    virtual ~RequestObserver() {}
+    virtual void OnRequestDone(int socket_id, uint32_t msgid, linear::SocketImpl::RequestObserver::Outcome outcome) = 0;
+  };
+
  public:
   // Client Socket
   SocketImpl(const std::string& host, int port,
@@ -49,15 +68,31 @@ class SocketImpl {
   inline int GetId() { return id_; }
   inline linear::Socket::Type GetType() { return type_; }
   inline linear::Socket::State GetState() { return state_; }
-  inline const linear::Addrinfo& GetSelfInfo() { return self_; }
-  inline const linear::Addrinfo& GetPeerInfo() { return peer_; }
+  const linear::Addrinfo& GetSelfInfo();
+  const linear::Addrinfo& GetPeerInfo();
+  // "addr:port" or "[addr]:port" for logs, built once per connection.
+  // a label is never modified, so it stays valid while the caller holds it
+  linear::shared_ptr<const std::string> GetSelfLabel();
+  linear::shared_ptr<const std::string> GetPeerLabel();
+  static const char* GetTypeName(linear::Socket::Type type);
+  inline size_t GetOutstandingRequests() { return request_timers_.Size(); }
+  inline void GetStats(linear::Stats* stats) { stats_.Snapshot(stats); }
 
   void SetMaxBufferSize(size_t limit);
   void SetMaxSendBufferSize(size_t limit);
   void SetMaxRecvBufferSize(size_t limit);
+  void SetWriteCoalescing(bool enable);
+  // observers are held weakly, and expired ones are dropped as requests end
+  void AddRequestObserver(const linear::shared_ptr<linear::SocketImpl::RequestObserver>& observer);
+  void RemoveRequestObserver(const linear::shared_ptr<linear::SocketImpl::RequestObserver>& observer);
+  linear::Error SetReconnect(bool enable, const linear::Socket::ReconnectPolicy& policy);
   linear::Error Connect(unsigned int timeout, linear::EventLoopImpl::SocketEvent* ev);
   linear::Error Disconnect(bool handshaking = false);
   linear::Error Send(const linear::Message& message, int timeout);
+#if !defined(MSGPACK_USE_CPP03)
+  linear::Error Send(linear::Message&& message, int timeout);
+#endif
+  linear::Error Send(const linear::shared_ptr<const linear::SharedBuffer>& buffer, int timeout);
   linear::Error KeepAlive(unsigned int interval, unsigned int retry, Socket::KeepAliveType type);
   linear::Error BindToDevice(const std::string& ifname);
   linear::Error SetSockOpt(int level, int optname, const void* optval, size_t optlen);
@@ -69,7 +104,9 @@ class SocketImpl {
   void OnRead(const shared_ptr<SocketImpl>& socket, const tv_buf_t *buffer, ssize_t nread);
   void OnWrite(const shared_ptr<SocketImpl>& socket, const linear::Message* message, int status);
   void OnConnectTimeout(const shared_ptr<SocketImpl>& socket);
-  void OnRequestTimeout(const shared_ptr<SocketImpl>& socket, const linear::Request& request);
+  void OnFlush(const shared_ptr<SocketImpl>& socket);
+  void OnReconnect(const shared_ptr<SocketImpl>& socket);
+  void OnRequestTimeout(const shared_ptr<SocketImpl>& socket, linear::SocketImpl::RequestTimer* request_timer);
 
  protected:
   virtual linear::Error Connect() = 0;
@@ -77,16 +114,78 @@ class SocketImpl {
   linear::Socket::State state_;
   tv_stream_t* stream_;
   linear::EventLoopImpl::SocketEvent* ev_;
-  linear::Addrinfo self_, peer_;
+  linear::Addrinfo self_, peer_;  // use GetSelfInfo and GetPeerInfo to read
   std::string bind_ifname_;
   linear::mutex state_mutex_;
   linear::shared_ptr<linear::EventLoopImpl> loop_;
 
  private:
-  linear::Error _Send(linear::Message* ctx);
+  // a message waiting in pending_messages_ or corked_messages_: either owned,
+  // or packed once into a buffer shared with other sockets
+  struct Outgoing {
+    explicit Outgoing(linear::Message* m) : message(m), timeout(0) {}
+    Outgoing(const linear::shared_ptr<const linear::SharedBuffer>& b, int t) : message(NULL), buffer(b), timeout(t) {}
+    linear::Message* message;  // NULL when buffer is used
+    linear::shared_ptr<const linear::SharedBuffer> buffer;
+    int timeout;  // of a request in buffer
+  };
+
+  static const linear::Message& _GetMessage(const linear::SocketImpl::Outgoing& entry);
+  linear::Error _Pack(linear::Message* message, linear::WriteBuffer* wbuf,
+                      linear::SocketImpl::RequestTimer** request_timer);
+  linear::Error _Queue(const linear::SocketImpl::Outgoing& entry);
+  linear::Error _Send(const linear::SocketImpl::Outgoing& entry);
+  linear::Error _Write(const linear::SocketImpl::Outgoing& entry);
+  linear::Error _Write(linear::Message* message);
+  linear::Error _Write(const linear::shared_ptr<const linear::SharedBuffer>& buffer, int timeout);
+  linear::Error _Write(const std::vector<linear::SocketImpl::Outgoing>& entries,
+                       std::vector<linear::SocketImpl::Outgoing>* fail_to_send);
+  linear::Error _Write(const std::vector<linear::Message*>& messages,
+                       std::vector<linear::SocketImpl::Outgoing>* fail_to_send);
+  // a request timer is started before its request is written,
+  // so that the response never comes before the timer is registered
+  linear::Error _StartRequestTimer(linear::SocketImpl::RequestTimer* request_timer);
+  // deletes a started request timer unless it has already timed out
+  void _StopRequestTimer(linear::SocketImpl::RequestTimer* request_timer);
+  void _NotifyRequestDone(uint32_t msgid, linear::SocketImpl::RequestObserver::Outcome outcome);
+  void _CancelMessages(const shared_ptr<SocketImpl>& socket,
+                       const std::vector<linear::SocketImpl::Outgoing>& entries, const linear::Error& err);
   void _SendPendingMessages(const shared_ptr<SocketImpl>& socket);
-  void _DiscardMessages(const shared_ptr<SocketImpl>& socket);
+  void _DiscardMessages(const shared_ptr<SocketImpl>& socket, bool keep_notifies = false);
+  // must be called under state_mutex_
+  bool _ScheduleReconnect(const shared_ptr<SocketImpl>& socket);
+  // counts into stats_, and into the sums of the accepting server if any
+  inline void _Count(linear::StatsCounters::Field field, size_t n) {
+    stats_.Add(field, n);
+    if (server_stats_) {
+      server_stats_->Add(field, n);
+    }
+  }
+  inline void _Uncount(linear::StatsCounters::Field field, size_t n) {
+    stats_.Sub(field, n);
+    if (server_stats_) {
+      server_stats_->Sub(field, n);
+    }
+  }
+  // must be called under state_mutex_ after pending_messages_ or corked_messages_ change
+  void _UpdateQueueDepth();
+  void _DispatchMessage(const shared_ptr<SocketImpl>& socket,
+                        const shared_ptr<linear::HandlerDelegate>& delegate,
+                        msgpack::object_handle& handle);
+  // the raw address is formatted into self_ or peer_ on first access,
+  // and the labels are dropped whenever the address changes
+  void _SetSelfInfo(const struct sockaddr* sa);
+  void _SetPeerInfo(const struct sockaddr* sa);
+  void _ResetSelfInfo();
 
+  union Sockaddr {
+    struct sockaddr_storage ss;
+    struct sockaddr sa;
+  };
+  linear::mutex info_mutex_;
+  Sockaddr self_addr_, peer_addr_;
+  bool self_pending_, peer_pending_;
+  linear::shared_ptr<const std::string> self_label_, peer_label_;
   linear::Socket::Type type_;
   int id_;
   bool connectable_;
@@ -95,12 +194,29 @@ class SocketImpl {
   linear::weak_ptr<linear::HandlerDelegate> delegate_;
   int connect_timeout_;
   linear::Timer connect_timer_;
-  std::vector<linear::Message*> pending_messages_;
-  std::vector<linear::SocketImpl::RequestTimer*> request_timers_;
-  linear::mutex request_timer_mutex_;
+  bool write_coalescing_;
+  linear::Timer flush_timer_;
+  // while reconnecting_, pending_messages_ is the outbox of notifies
+  linear::Timer reconnect_timer_;
+  linear::EventLoopImpl::SocketEvent* reconnect_ev_;
+  linear::Socket::ReconnectPolicy reconnect_policy_;
+  bool reconnect_enabled_;
+  bool reconnecting_;
+  unsigned int reconnect_attempts_;
+  uint32_t reconnect_random_;
+  std::vector<linear::SocketImpl::Outgoing> pending_messages_;
+  std::vector<linear::SocketImpl::Outgoing> corked_messages_;
+  linear::RequestPool<linear::SocketImpl::RequestTimer> request_timers_;
   size_t max_send_buffer_size_;
   size_t max_recv_buffer_size_;
   msgpack::unpacker unpacker_;
+  // send_queue_depth counts queued_ messages plus those being written
+  linear::StatsCounters stats_;
+  linear::shared_ptr<linear::StatsCounters> server_stats_;
+  size_t queued_;
+  linear::mutex observers_mutex_;
+  std::vector<linear::weak_ptr<linear::SocketImpl::RequestObserver> > observers_;
+  volatile size_t observed_; // observers_.size(), so that unobserved sockets skip the lock
 };
 
 }  // namespace linear
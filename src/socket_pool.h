@@ -6,15 +6,23 @@
 #include "linear/group.h"
 
 #include "socket_impl.h"
+#include "unordered_map_inc.h"
 
 namespace linear {
 
+// Sockets of a server or a client indexed by id.
+// Ids are spread over SHARDS maps with their own locks, so accepts and
+// disconnects on different sockets rarely contend; only the count shared
+// by all shards is guarded by one short critical section.
 class SocketPool {
  public:
-  SocketPool() : max_(-1) {
+  static const int SHARDS = 16; // power of 2
+
+  SocketPool() : max_(0), count_(0) {
   }
   ~SocketPool() {}
   void SetMaxLimit(size_t max) {
+    linear::lock_guard<linear::mutex> lock(count_mutex_);
     max_ = max;
   }
   linear::Error Add(const linear::shared_ptr<linear::SocketImpl>& s) {
@@ -22,25 +30,33 @@ class SocketPool {
     if (id < 0) {
       return Error(LNR_EINVAL);
     }
-    linear::lock_guard<linear::mutex> lock(mutex_);
-    if (max_ > 0 && max_ <= pool_.size()) {
+    Shard& shard = shards_[id & (SHARDS - 1)];
+    linear::lock_guard<linear::mutex> lock(shard.mutex);
+    if (shard.sockets.find(id) != shard.sockets.end()) {
+      LINEAR_LOG(linear::log::LOG_WARN, "Socket(type = %d, id = %d) already exists", s->GetType(), id);
+      return Error(LNR_OK);
+    }
+    {
+      linear::lock_guard<linear::mutex> count_lock(count_mutex_);
+      if (max_ > 0 && max_ <= count_) {
 #ifdef _WIN32
-      LINEAR_LOG(linear::log::LOG_WARN, "Socket(type = %d, id = %d) excess MaxLimits(%Iu)",
-                 s->GetType(), id, max_);
+        LINEAR_LOG(linear::log::LOG_WARN, "Socket(type = %d, id = %d) excess MaxLimits(%Iu)",
+                   s->GetType(), id, max_);
 #else
-      LINEAR_LOG(linear::log::LOG_WARN, "Socket(type = %d, id = %d) excess MaxLimits(%zu)",
-                 s->GetType(), id, max_);
+        LINEAR_LOG(linear::log::LOG_WARN, "Socket(type = %d, id = %d) excess MaxLimits(%zu)",
+                   s->GetType(), id, max_);
 #endif
-      return Error(LNR_ENOSPC);
-    }
-    for (std::vector<linear::shared_ptr<linear::SocketImpl> >::iterator it = pool_.begin();
-         it != pool_.end(); it++) {
-      if (id == (*it)->GetId()) {
-        LINEAR_LOG(linear::log::LOG_WARN, "Socket(type = %d, id = %d) already exists", s->GetType(), id);
-        return Error(LNR_OK);
+        return Error(LNR_ENOSPC);
       }
+      count_++;
+    }
+    try {
+      shard.sockets.insert(std::make_pair(id, s));
+    } catch(...) {
+      linear::lock_guard<linear::mutex> count_lock(count_mutex_);
+      count_--;
+      return Error(LNR_ENOMEM);
     }
-    pool_.push_back(s);
     LINEAR_DEBUG(linear::log::LOG_DEBUG, "Socket(type = %d, id = %d) is added", s->GetType(), id);
     return Error(LNR_OK);
   }
@@ -49,30 +65,47 @@ class SocketPool {
     if (id < 0) {
       return;
     }
-    linear::lock_guard<linear::mutex> lock(mutex_);
-    for (std::vector<linear::shared_ptr<linear::SocketImpl> >::iterator it = pool_.begin();
-         it != pool_.end(); it++) {
-      if (id == (*it)->GetId()) {
-        LINEAR_DEBUG(linear::log::LOG_DEBUG, "Socket(type = %d, id = %d) is removed", s->GetType(), id);
-        pool_.erase(it);
-        return;
-      }
+    Shard& shard = shards_[id & (SHARDS - 1)];
+    linear::lock_guard<linear::mutex> lock(shard.mutex);
+    if (shard.sockets.erase(id) == 0) {
+      LINEAR_LOG(linear::log::LOG_WARN, "Socket(id = %d) is already removed", id);
+      return;
     }
-    LINEAR_LOG(linear::log::LOG_WARN, "Socket(id = %d) is already removed", id);
+    LINEAR_DEBUG(linear::log::LOG_DEBUG, "Socket(type = %d, id = %d) is removed", s->GetType(), id);
+    linear::lock_guard<linear::mutex> count_lock(count_mutex_);
+    count_--;
   }
   void Clear() {
-    linear::lock_guard<linear::mutex> lock(mutex_);
-    for (std::vector<linear::shared_ptr<linear::SocketImpl> >::iterator it = pool_.begin();
-         it != pool_.end(); it++) {
-      linear::Group::LeaveAll(Socket(*it));
+    for (int i = 0; i < SHARDS; i++) {
+      Map sockets;
+      {
+        linear::lock_guard<linear::mutex> lock(shards_[i].mutex);
+        sockets.swap(shards_[i].sockets);
+        linear::lock_guard<linear::mutex> count_lock(count_mutex_);
+        count_ -= sockets.size();
+      }
+      for (Map::iterator it = sockets.begin(); it != sockets.end(); it++) {
+        linear::Group::LeaveAll(Socket(it->second));
+      }
     }
-    pool_.clear();
+  }
+  size_t Size() {
+    linear::lock_guard<linear::mutex> count_lock(count_mutex_);
+    return count_;
   }
 
  protected:
+  typedef linear::unordered_map<int, linear::shared_ptr<linear::SocketImpl> > Map;
+
+  struct Shard {
+    linear::mutex mutex;
+    Map sockets;
+  };
+
+  Shard shards_[SHARDS];
   size_t max_;
-  std::vector<shared_ptr<linear::SocketImpl> > pool_;
-  linear::mutex mutex_;
+  size_t count_;
+  linear::mutex count_mutex_;
 };
 
 } // namespace linear
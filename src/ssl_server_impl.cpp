@@ -3,6 +3,7 @@
 
 #include "linear/ssl_socket.h"
 
+#include "resolver.h"
 #include "ssl_server_impl.h"
 #include "ssl_socket_impl.h"
 
@@ -55,8 +56,9 @@ Error SSLServerImpl::Start(const std::string& hostname, int port, EventLoopImpl:
   handle_->data = ev;
   std::ostringstream port_str;
   port_str << port;
+  // listens on the address resolved for self_ above, so libtv does not look it up again
   ret = tv_listen(reinterpret_cast<tv_stream_t*>(handle_),
-                  hostname.c_str(), port_str.str().c_str(), ServerImpl::BACKLOG, EventLoopImpl::OnAccept);
+                  Resolver::GetAddress(hostname).c_str(), port_str.str().c_str(), backlog_, EventLoopImpl::OnAccept);
   if (ret) {
     Error err(ret);
     LINEAR_LOG(LOG_ERR, "fail to start server(%s:%d,SSL): %s",
@@ -0,0 +1,68 @@
+#ifndef LINEAR_STATS_COUNTERS_H_
+#define LINEAR_STATS_COUNTERS_H_
+
+#include "linear/stats.h"
+
+#include "atomic_ops.h"
+
+namespace linear {
+
+// Counters behind linear::Stats.
+// Updated with relaxed atomics on the hot path, so a snapshot is only
+// a few loads; gauges are kept by adding and subtracting deltas.
+// Counters are word-sized, as 64bit atomics need cmpxchg8b loops on 32bit MSVC
+// and libatomic on some ARM targets: on 32bit builds they wrap at 2^32.
+class StatsCounters {
+ public:
+  enum Field {
+    BYTES_IN,
+    BYTES_OUT,
+    MESSAGES_IN,
+    MESSAGES_OUT,
+    SEND_QUEUE_DEPTH,
+    OUTSTANDING_REQUESTS,
+    TIMEOUTS,
+    DECODE_ERRORS,
+    RECONNECTS,
+    FIELDS
+  };
+
+  StatsCounters() {
+    for (int i = 0; i < FIELDS; i++) {
+      values_[i] = 0;
+    }
+  }
+  ~StatsCounters() {}
+
+  inline void Add(Field field, size_t n) {
+    atomic::FetchAddRelaxed(&values_[field], n);
+  }
+  // gauges wrap around through unsigned arithmetic and come back
+  inline void Sub(Field field, size_t n) {
+    atomic::FetchAddRelaxed(&values_[field], static_cast<size_t>(0) - n);
+  }
+  inline size_t Get(Field field) const {
+    return atomic::LoadRelaxed(&values_[field]);
+  }
+  void Snapshot(linear::Stats* stats) const {
+    stats->bytes_in = Get(BYTES_IN);
+    stats->bytes_out = Get(BYTES_OUT);
+    stats->messages_in = Get(MESSAGES_IN);
+    stats->messages_out = Get(MESSAGES_OUT);
+    stats->send_queue_depth = Get(SEND_QUEUE_DEPTH);
+    stats->outstanding_requests = Get(OUTSTANDING_REQUESTS);
+    stats->timeouts = Get(TIMEOUTS);
+    stats->decode_errors = Get(DECODE_ERRORS);
+    stats->reconnects = Get(RECONNECTS);
+  }
+
+ private:
+  StatsCounters(const StatsCounters&);
+  StatsCounters& operator=(const StatsCounters&);
+
+  volatile size_t values_[FIELDS];
+};
+
+}  // namespace linear
+
+#endif  // LINEAR_STATS_COUNTERS_H_
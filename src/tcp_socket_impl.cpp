@@ -1,5 +1,6 @@
 #include <sstream>
 
+#include "resolver.h"
 #include "tcp_socket_impl.h"
 
 namespace linear {
@@ -39,7 +40,10 @@ Error TCPSocketImpl::Connect() {
   stream_->data = ev_;
   std::ostringstream port_str;
   port_str << peer_.port;
-  ret = tv_connect(stream_, peer_.addr.c_str(), port_str.str().c_str(), EventLoopImpl::OnConnect);
+  // connects to the cached address without DNS; SSL and WS keep the host name,
+  // which libtv also presents to the peer (server name, Host header)
+  ret = tv_connect(stream_, Resolver::GetAddress(peer_.addr).c_str(), port_str.str().c_str(),
+                   EventLoopImpl::OnConnect);
   if (ret) {
     assert(false); // never reach now
     free(stream_);
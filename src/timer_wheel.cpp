@@ -0,0 +1,221 @@
+#include <cassert>
+#include <cstdlib>
+
+#include "linear/log.h"
+
+#include "timer_wheel.h"
+
+using namespace linear::log;
+
+namespace linear {
+
+static const uint64_t MAX_DELTA = (static_cast<uint64_t>(1) << 32) - 1;
+
+TimerWheel::TimerWheel(tv_loop_t* loop)
+  : loop_(loop), tv_timer_(NULL), armed_(false), armed_tick_(0), current_(Now()), count_(0), firing_(NULL) {
+  for (uint64_t i = 0; i < ROOT_SIZE; i++) {
+    root_[i].prev_ = root_[i].next_ = &root_[i];
+  }
+  for (int level = 0; level < LEVELS; level++) {
+    for (uint64_t i = 0; i < LEVEL_SIZE; i++) {
+      levels_[level][i].prev_ = levels_[level][i].next_ = &levels_[level][i];
+    }
+  }
+  expired_.prev_ = expired_.next_ = &expired_;
+}
+
+TimerWheel::~TimerWheel() {
+  Close();
+}
+
+Error TimerWheel::Init(EventLoopImpl::TimerWheelEvent* ev) {
+  lock_guard<mutex> lock(mutex_);
+  if (tv_timer_ != NULL) {
+    return Error(LNR_EALREADY);
+  }
+  tv_timer_t* tv_timer = static_cast<tv_timer_t*>(malloc(sizeof(tv_timer_t)));
+  if (tv_timer == NULL) {
+    return Error(LNR_ENOMEM);
+  }
+  int ret = tv_timer_init(loop_, tv_timer);
+  if (ret) {
+    LINEAR_LOG(LOG_ERR, "fail to init timer wheel: %s", tv_strerror(reinterpret_cast<tv_handle_t*>(tv_timer), ret));
+    free(tv_timer);
+    return Error(ret);
+  }
+  tv_timer->data = ev;
+  tv_timer_ = tv_timer;
+  return Error(LNR_OK);
+}
+
+void TimerWheel::Close() {
+  lock_guard<mutex> lock(mutex_);
+  if (tv_timer_ == NULL) {
+    return;
+  }
+  tv_timer_stop(tv_timer_);
+  tv_close(reinterpret_cast<tv_handle_t*>(tv_timer_), EventLoopImpl::OnClose);
+  tv_timer_ = NULL;
+  armed_ = false;
+}
+
+Error TimerWheel::Add(Entry* entry, TimerCallback callback, unsigned int timeout, void* args) {
+  assert(entry != NULL && entry->next_ == NULL);
+  uint64_t now = Now();
+  lock_guard<mutex> lock(mutex_);
+  if (tv_timer_ == NULL) {
+    return Error(LNR_EBADF);
+  }
+  if (count_ == 0) {
+    current_ = now; // nothing to cascade, skip idle ticks
+  }
+  entry->callback_ = callback;
+  entry->args_ = args;
+  entry->expire_ = now + timeout;
+  if (entry->expire_ <= current_) {
+    entry->expire_ = current_ + 1; // current tick is already processed
+  }
+  Place(entry);
+  count_++;
+  Rearm();
+  return Error(LNR_OK);
+}
+
+void TimerWheel::Remove(Entry* entry) {
+  assert(entry != NULL);
+  unique_lock<mutex> lock(mutex_);
+  if (entry->next_ != NULL) {
+    Unlink(entry);
+    count_--;
+    return;
+  }
+  // the callback may delete the entry by itself on the loop thread
+  uv_thread_t self = uv_thread_self();
+  while (firing_ == entry && !uv_thread_equal(&self, &firing_thread_)) {
+    fired_cond_.wait(lock);
+  }
+}
+
+void TimerWheel::OnTimer() {
+  unique_lock<mutex> lock(mutex_);
+  armed_ = false;
+  Advance(Now());
+  // entries may be removed by callbacks of preceding entries, so pop one by one
+  while (expired_.next_ != &expired_) {
+    Entry* entry = expired_.next_;
+    Unlink(entry);
+    count_--;
+    TimerCallback callback = entry->callback_;
+    void* args = entry->args_;
+    firing_ = entry;
+    firing_thread_ = uv_thread_self();
+    lock.unlock();
+    if (callback != NULL) {
+      (*callback)(args); // entry may be deleted here
+    }
+    lock.lock();
+    firing_ = NULL;
+    fired_cond_.notify_all();
+  }
+  Rearm();
+}
+
+uint64_t TimerWheel::Now() {
+  return uv_hrtime() / 1000000; // msec
+}
+
+void TimerWheel::Link(Entry* head, Entry* entry) {
+  entry->next_ = head;
+  entry->prev_ = head->prev_;
+  head->prev_->next_ = entry;
+  head->prev_ = entry;
+}
+
+void TimerWheel::Unlink(Entry* entry) {
+  entry->prev_->next_ = entry->next_;
+  entry->next_->prev_ = entry->prev_;
+  entry->prev_ = entry->next_ = NULL;
+}
+
+void TimerWheel::Splice(Entry* from, Entry* to) {
+  if (from->next_ == from) {
+    return;
+  }
+  from->next_->prev_ = to->prev_;
+  to->prev_->next_ = from->next_;
+  from->prev_->next_ = to;
+  to->prev_ = from->prev_;
+  from->prev_ = from->next_ = from;
+}
+
+void TimerWheel::Place(Entry* entry) {
+  uint64_t expire = entry->expire_;
+  uint64_t delta = expire - current_;
+  if (delta < ROOT_SIZE) {
+    Link(&root_[expire & (ROOT_SIZE - 1)], entry);
+    return;
+  }
+  if (delta > MAX_DELTA) {
+    expire = current_ + MAX_DELTA; // re-placed by cascade until expire_ is in range
+  }
+  int level = 0;
+  while (level < LEVELS - 1 && delta >= (static_cast<uint64_t>(1) << (ROOT_BITS + (level + 1) * LEVEL_BITS))) {
+    level++;
+  }
+  Link(&levels_[level][(expire >> (ROOT_BITS + level * LEVEL_BITS)) & (LEVEL_SIZE - 1)], entry);
+}
+
+void TimerWheel::Cascade() {
+  for (int level = 0; level < LEVELS; level++) {
+    uint64_t index = (current_ >> (ROOT_BITS + level * LEVEL_BITS)) & (LEVEL_SIZE - 1);
+    Entry list;
+    list.prev_ = list.next_ = &list;
+    Splice(&levels_[level][index], &list);
+    while (list.next_ != &list) {
+      Entry* entry = list.next_;
+      Unlink(entry);
+      Place(entry);
+    }
+    if (index != 0) {
+      break;
+    }
+  }
+}
+
+void TimerWheel::Advance(uint64_t now) {
+  while (current_ < now) {
+    current_++;
+    uint64_t index = current_ & (ROOT_SIZE - 1);
+    if (index == 0) {
+      Cascade();
+    }
+    Splice(&root_[index], &expired_);
+  }
+}
+
+void TimerWheel::Rearm() {
+  if (tv_timer_ == NULL || count_ == 0) {
+    return; // an armed tv_timer fires once more and finds nothing
+  }
+  // next non-empty slot of root, or next cascade point
+  uint64_t next = current_ + 1;
+  while ((next & (ROOT_SIZE - 1)) != 0 && root_[next & (ROOT_SIZE - 1)].next_ == &root_[next & (ROOT_SIZE - 1)]) {
+    next++;
+  }
+  if (expired_.next_ != &expired_) {
+    next = current_;
+  }
+  if (armed_ && armed_tick_ <= next) {
+    return;
+  }
+  uint64_t now = Now();
+  int ret = tv_timer_start(tv_timer_, EventLoopImpl::OnTimerWheel, (next > now) ? (next - now) : 0, 0);
+  if (ret) {
+    LINEAR_LOG(LOG_ERR, "fail to start timer wheel: %s", tv_strerror(reinterpret_cast<tv_handle_t*>(tv_timer_), ret));
+    return;
+  }
+  armed_ = true;
+  armed_tick_ = next;
+}
+
+}  // namespace linear
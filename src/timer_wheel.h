@@ -0,0 +1,80 @@
+#ifndef LINEAR_TIMER_WHEEL_H_
+#define LINEAR_TIMER_WHEEL_H_
+
+#include <stdint.h>
+
+#include "linear/condition_variable.h"
+#include "linear/timer.h"
+
+#include "event_loop_impl.h"
+
+namespace linear {
+
+// Hierarchical timing wheel (1 msec tick) shared by every request of an EventLoop.
+// Only one tv_timer is armed per wheel, to the next non-empty slot or cascade point,
+// and adding or removing an entry is a list insert or unlink.
+class TimerWheel {
+ public:
+  class Entry {
+   public:
+    Entry() : prev_(NULL), next_(NULL), expire_(0), callback_(NULL), args_(NULL) {}
+    virtual ~Entry() {}
+
+   private:
+    friend class TimerWheel;
+    Entry* prev_;
+    Entry* next_;
+    uint64_t expire_;
+    linear::TimerCallback callback_;
+    void* args_;
+  };
+
+ public:
+  TimerWheel(tv_loop_t* loop);
+  ~TimerWheel();
+  linear::Error Init(linear::EventLoopImpl::TimerWheelEvent* ev);
+  void Close();
+  // callback is called on the loop thread, after the entry is removed from the wheel
+  linear::Error Add(Entry* entry, linear::TimerCallback callback, unsigned int timeout, void* args);
+  // when the callback of the entry is running on another thread, waits for it to return,
+  // so that the entry may be deleted right after Remove
+  void Remove(Entry* entry);
+  void OnTimer();
+
+ private:
+  static const int ROOT_BITS = 8;
+  static const int LEVEL_BITS = 6;
+  static const int LEVELS = 4;
+  static const uint64_t ROOT_SIZE = (1 << ROOT_BITS);
+  static const uint64_t LEVEL_SIZE = (1 << LEVEL_BITS);
+
+  TimerWheel(const TimerWheel& wheel);
+  TimerWheel& operator=(const TimerWheel& wheel);
+
+  static uint64_t Now();
+  static void Link(Entry* head, Entry* entry);
+  static void Unlink(Entry* entry);
+  static void Splice(Entry* from, Entry* to);
+  void Place(Entry* entry);
+  void Cascade();
+  void Advance(uint64_t now);
+  void Rearm();
+
+  tv_loop_t* loop_;
+  tv_timer_t* tv_timer_;
+  bool armed_;
+  uint64_t armed_tick_;
+  uint64_t current_;
+  size_t count_;
+  Entry root_[ROOT_SIZE];
+  Entry levels_[LEVELS][LEVEL_SIZE];
+  Entry expired_;
+  Entry* firing_; // whose callback is running without mutex_
+  uv_thread_t firing_thread_;
+  linear::mutex mutex_;
+  linear::condition_variable fired_cond_;
+};
+
+}  // namespace linear
+
+#endif  // LINEAR_TIMER_WHEEL_H_
@@ -0,0 +1,27 @@
+#ifndef LINEAR_UNORDERED_MAP_INC_H_
+#define LINEAR_UNORDERED_MAP_INC_H_
+
+#include "linear/memory.h"
+
+// hash containers come from the same library as shared_ptr
+#ifdef HAVE_STD_SHARED_PTR
+# include <unordered_map>
+#elif defined HAVE_TR1_SHARED_PTR
+# include <tr1/unordered_map>
+#endif
+
+namespace linear {
+
+#ifdef HAVE_STD_SHARED_PTR
+using std::unordered_map;
+using std::unordered_multimap;
+
+#elif defined HAVE_TR1_SHARED_PTR
+using std::tr1::unordered_map;
+using std::tr1::unordered_multimap;
+
+#endif
+
+}  // namespace linear
+
+#endif  // LINEAR_UNORDERED_MAP_INC_H_
@@ -0,0 +1,38 @@
+#include "linear/worker_pool.h"
+
+#include "worker_pool_impl.h"
+
+namespace linear {
+
+WorkerPool::WorkerPool(size_t num_workers, size_t max_queue_depth)
+  : pool_(new WorkerPoolImpl(num_workers, max_queue_depth)) {
+}
+
+WorkerPool::~WorkerPool() {
+}
+
+const linear::shared_ptr<linear::WorkerPoolImpl> WorkerPool::GetImpl() const {
+  return pool_;
+}
+
+size_t WorkerPool::GetNumWorkers() const {
+  return pool_->GetNumWorkers();
+}
+
+size_t WorkerPool::GetMaxQueueDepth() const {
+  return pool_->GetMaxQueueDepth();
+}
+
+size_t WorkerPool::GetQueueDepth() const {
+  return pool_->GetQueueDepth();
+}
+
+size_t WorkerPool::GetPeakQueueDepth() const {
+  return pool_->GetPeakQueueDepth();
+}
+
+size_t WorkerPool::GetRejectedCount() const {
+  return pool_->GetRejectedCount();
+}
+
+} // namespace linear
@@ -0,0 +1,135 @@
+#include <cassert>
+
+#include "linear/log.h"
+
+#include "worker_pool_impl.h"
+
+using namespace linear::log;
+
+namespace linear {
+
+WorkerPoolImpl::WorkerPoolImpl(size_t num_workers, size_t max_queue_depth)
+  : max_queue_depth_((max_queue_depth > 0) ? max_queue_depth : 1),
+    queue_depth_(0), peak_queue_depth_(0), rejected_(0), stop_(false) {
+  if (num_workers == 0) {
+    num_workers = 1;
+  }
+  threads_.reserve(num_workers);
+  for (size_t i = 0; i < num_workers; i++) {
+    uv_thread_t thread;
+    if (uv_thread_create(&thread, WorkerPoolImpl::Work, this)) {
+      LINEAR_LOG(LOG_ERR, "fail to create worker thread: %u of %u created",
+                 static_cast<unsigned int>(threads_.size()), static_cast<unsigned int>(num_workers));
+      break;
+    }
+    threads_.push_back(thread);
+  }
+}
+
+// must not be destroyed on one of its own workers
+WorkerPoolImpl::~WorkerPoolImpl() {
+  unique_lock<mutex> lock(mutex_);
+  stop_ = true;
+  ready_cond_.notify_all();
+  lock.unlock();
+  // workers run what is already queued before they exit
+  for (std::vector<uv_thread_t>::iterator it = threads_.begin(); it != threads_.end(); it++) {
+    uv_thread_join(&(*it));
+  }
+  assert(ready_.empty());
+}
+
+Error WorkerPoolImpl::Post(int key, Task* task, bool droppable) {
+  assert(task != NULL);
+  if (threads_.empty()) { // no worker could be created
+    try {
+      task->Run();
+    } catch(...) {
+    }
+    delete task;
+    return Error(LNR_OK);
+  }
+  unique_lock<mutex> lock(mutex_);
+  if (stop_ || (droppable && queue_depth_ >= max_queue_depth_)) {
+    Error err(stop_ ? LNR_ECANCELED : LNR_ENOBUFS);
+    if (!stop_) {
+      rejected_++;
+    }
+    lock.unlock();
+    delete task;
+    return err;
+  }
+  Strand& strand = strands_[key];
+  strand.tasks.push_back(task);
+  queue_depth_++;
+  if (queue_depth_ > peak_queue_depth_) {
+    peak_queue_depth_ = queue_depth_;
+  }
+  if (!strand.scheduled) {
+    strand.scheduled = true;
+    ready_.push_back(key);
+    ready_cond_.notify_one();
+  }
+  return Error(LNR_OK);
+}
+
+size_t WorkerPoolImpl::GetQueueDepth() const {
+  lock_guard<mutex> lock(mutex_);
+  return queue_depth_;
+}
+
+size_t WorkerPoolImpl::GetPeakQueueDepth() const {
+  lock_guard<mutex> lock(mutex_);
+  return peak_queue_depth_;
+}
+
+size_t WorkerPoolImpl::GetRejectedCount() const {
+  lock_guard<mutex> lock(mutex_);
+  return rejected_;
+}
+
+void WorkerPoolImpl::Work(void* args) {
+  WorkerPoolImpl* pool = static_cast<WorkerPoolImpl*>(args);
+  pool->_Work();
+}
+
+void WorkerPoolImpl::_Work() {
+  unique_lock<mutex> lock(mutex_);
+  while (true) {
+    while (ready_.empty() && !stop_) {
+      ready_cond_.wait(lock);
+    }
+    if (ready_.empty()) { // stop_ and nothing left
+      return;
+    }
+    int key = ready_.front();
+    ready_.pop_front();
+    Strand& strand = strands_[key];
+    assert(strand.scheduled && !strand.tasks.empty());
+    Task* task = strand.tasks.front();
+    strand.tasks.pop_front();
+    queue_depth_--;
+    lock.unlock();
+
+    try {
+      task->Run();
+    } catch(...) {
+      LINEAR_LOG(LOG_WARN, "something wrong at worker task");
+    }
+    delete task;
+
+    lock.lock();
+    // the strand stays with this worker until its task is done,
+    // so the next task of the same key cannot overtake it
+    linear::unordered_map<int, Strand>::iterator it = strands_.find(key);
+    assert(it != strands_.end());
+    if (it->second.tasks.empty()) {
+      strands_.erase(it);
+    } else {
+      ready_.push_back(key);
+      ready_cond_.notify_one();
+    }
+  }
+}
+
+}  // namespace linear
@@ -0,0 +1,72 @@
+#ifndef LINEAR_WORKER_POOL_IMPL_H_
+#define LINEAR_WORKER_POOL_IMPL_H_
+
+#include <deque>
+#include <vector>
+
+#include "linear/condition_variable.h"
+#include "linear/error.h"
+#include "linear/mutex.h"
+
+#include "unordered_map_inc.h"
+#include "uv.h"
+
+namespace linear {
+
+// Fixed set of worker threads running tasks posted by event loops.
+// Tasks posted with the same key form a strand: they run one at a time and
+// in order, while different keys run in parallel. Posting never blocks:
+// an event loop waiting for room would stall every socket on it, and
+// a worker posting to its own full pool would wait for itself.
+class WorkerPoolImpl {
+ public:
+  class Task {
+   public:
+    virtual ~Task() {}
+    virtual void Run() = 0;
+  };
+
+ public:
+  WorkerPoolImpl(size_t num_workers, size_t max_queue_depth);
+  ~WorkerPoolImpl();
+
+  // takes ownership of task.
+  // a droppable task is deleted and LNR_ENOBUFS is returned while max_queue_depth
+  // tasks are waiting; other tasks are queued anyway, so that no connection event is lost
+  linear::Error Post(int key, Task* task, bool droppable);
+
+  size_t GetNumWorkers() const {
+    return threads_.size();
+  }
+  size_t GetMaxQueueDepth() const {
+    return max_queue_depth_;
+  }
+  size_t GetQueueDepth() const;
+  size_t GetPeakQueueDepth() const;
+  size_t GetRejectedCount() const;
+
+ private:
+  struct Strand {
+    Strand() : scheduled(false) {}
+    std::deque<Task*> tasks;
+    bool scheduled; // queued in ready_ or running on a worker
+  };
+
+  static void Work(void* args);
+  void _Work();
+
+  mutable linear::mutex mutex_;
+  linear::condition_variable ready_cond_;
+  linear::unordered_map<int, Strand> strands_;
+  std::deque<int> ready_;
+  std::vector<uv_thread_t> threads_;
+  size_t max_queue_depth_;
+  size_t queue_depth_;
+  size_t peak_queue_depth_;
+  size_t rejected_;
+  bool stop_;
+};
+
+}  // namespace linear
+
+#endif  // LINEAR_WORKER_POOL_IMPL_H_
@@ -0,0 +1,72 @@
+#ifndef LINEAR_WRITE_BUFFER_H_
+#define LINEAR_WRITE_BUFFER_H_
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "tv.h"
+
+namespace linear {
+
+// msgpack stream which packs directly behind the tv_write_t that sends it.
+// Layout of the single allocation: [ tv_write_t | packed message ]
+class WriteBuffer {
+ public:
+  static const size_t INITIAL_SIZE = 256;
+
+  WriteBuffer() : block_(NULL), size_(0), capacity_(0) {}
+  ~WriteBuffer() {
+    free(block_);
+  }
+  // called by msgpack::packer
+  void write(const char* data, size_t size) {
+    if (size_ + size > capacity_) {
+      Expand(size);
+    }
+    memcpy(block_ + sizeof(tv_write_t) + size_, data, size);
+    size_ += size;
+  }
+  const char* data() const {
+    return (block_ == NULL) ? NULL : block_ + sizeof(tv_write_t);
+  }
+  size_t size() const {
+    return size_;
+  }
+  // hand the block over to the caller, which frees the returned tv_write_t
+  tv_write_t* Release(tv_buf_t* buffer) {
+    if (block_ == NULL) {
+      return NULL;
+    }
+    tv_write_t* w = reinterpret_cast<tv_write_t*>(block_);
+    *buffer = static_cast<tv_buf_t>(uv_buf_init(block_ + sizeof(tv_write_t), size_));
+    block_ = NULL;
+    size_ = capacity_ = 0;
+    return w;
+  }
+
+ private:
+  WriteBuffer(const WriteBuffer& buffer);
+  WriteBuffer& operator=(const WriteBuffer& buffer);
+
+  void Expand(size_t size) {
+    size_t capacity = (capacity_ == 0) ? INITIAL_SIZE : capacity_ * 2;
+    while (capacity < size_ + size) {
+      capacity *= 2;
+    }
+    char* block = static_cast<char*>(realloc(block_, sizeof(tv_write_t) + capacity));
+    if (block == NULL) {
+      throw std::bad_alloc();
+    }
+    block_ = block;
+    capacity_ = capacity;
+  }
+
+  char* block_;
+  size_t size_;
+  size_t capacity_;
+};
+
+} // namespace linear
+
+#endif // LINEAR_WRITE_BUFFER_H_
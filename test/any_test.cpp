@@ -363,6 +363,91 @@ TEST(AnyTest, ext) {
   }
 }
 
+TEST(AnyTest, lazyZone) {
+  {
+    linear::type::any a1, a2((linear::type::nil())), a3(1), a4(-1), a5(3.14), a6(true);
+    EXPECT_TRUE(a1.zone() == NULL);
+    EXPECT_TRUE(a2.zone() == NULL);
+    EXPECT_TRUE(a3.zone() == NULL);
+    EXPECT_TRUE(a4.zone() == NULL);
+    EXPECT_TRUE(a5.zone() == NULL);
+    EXPECT_TRUE(a6.zone() == NULL);
+    linear::type::any a7(a3);
+    EXPECT_TRUE(a7.zone() == NULL);
+    EXPECT_EQ(1, a7.as<int>());
+  }
+  {
+    std::string s = "test";
+    linear::type::any a1(s);
+    EXPECT_TRUE(a1.zone() != NULL);
+    linear::type::any a2(a1);
+    EXPECT_TRUE(a2.zone() != NULL);
+    EXPECT_EQ(s, a2.as<std::string>());
+    a2 = 1;
+    EXPECT_TRUE(a2.zone() == NULL);
+    EXPECT_EQ(1, a2.as<int>());
+    a2 = a1;
+    EXPECT_TRUE(a2.zone() != NULL);
+    EXPECT_EQ(s, a2.as<std::string>());
+    a2 = linear::type::nil();
+    EXPECT_TRUE(a2.zone() == NULL);
+    EXPECT_TRUE(a2.is_nil());
+  }
+  {
+    msgpack::unique_ptr<msgpack::zone> z(new msgpack::zone());
+    msgpack::object o(std::string("adopted"), *z);
+    linear::type::any a1;
+    a1.msgpack_adopt(o, z);
+    EXPECT_TRUE(z.get() == NULL);
+    EXPECT_TRUE(a1.zone() != NULL);
+    EXPECT_EQ(std::string("adopted"), a1.as<std::string>());
+    z.reset(new msgpack::zone());
+    linear::type::any a2;
+    a2.msgpack_adopt(msgpack::object(1), z);
+    EXPECT_TRUE(z.get() != NULL);
+    EXPECT_TRUE(a2.zone() == NULL);
+    EXPECT_EQ(1, a2.as<int>());
+  }
+}
+
+#if !defined(MSGPACK_USE_CPP03)
+TEST(AnyTest, move) {
+  std::string s = "test";
+  linear::type::any a1(s);
+  const msgpack::zone* z = a1.zone();
+  linear::type::any a2(std::move(a1));
+  EXPECT_TRUE(a2.zone() == z);
+  EXPECT_EQ(s, a2.as<std::string>());
+  EXPECT_TRUE(a1.zone() == NULL);
+  EXPECT_TRUE(a1.is_nil());
+  linear::type::any a3(1);
+  a3 = std::move(a2);
+  EXPECT_TRUE(a3.zone() == z);
+  EXPECT_EQ(s, a3.as<std::string>());
+  EXPECT_TRUE(a2.is_nil());
+  EXPECT_EQ(linear::type::any::NIL, a2.type);
+}
+#endif
+
+TEST(AnyTest, responseZones) {
+  // a Response with a nil error and a scalar result allocates no zone, even when copied
+  {
+    linear::type::any result(1), error((linear::type::nil())), params;
+    linear::type::any result_copy(result), error_copy(error), params_copy(params);
+    EXPECT_TRUE(result_copy.zone() == NULL);
+    EXPECT_TRUE(error_copy.zone() == NULL);
+    EXPECT_TRUE(params_copy.zone() == NULL);
+    result_copy = error;
+    EXPECT_TRUE(result_copy.zone() == NULL);
+  }
+  {
+    linear::type::any result(std::string("result")), error((linear::type::nil()));
+    linear::type::any result_copy(result), error_copy(error);
+    EXPECT_TRUE(result_copy.zone() != NULL);
+    EXPECT_TRUE(error_copy.zone() == NULL);
+  }
+}
+
 int main(int argc, char* argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,190 @@
+#include "test_common.h"
+
+#include "linear/client_pool.h"
+#include "linear/tcp_client.h"
+#include "linear/tcp_server.h"
+
+using namespace linear;
+using ::testing::_;
+using ::testing::AnyNumber;
+
+typedef LinearTest ClientPoolTest;
+
+TEST_F(ClientPoolTest, noHealthyMember) {
+  shared_ptr<MockHandler> ch = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl(ch);
+  ClientPool pool;
+
+  ASSERT_EQ(-1, pool.Select().GetId());
+  Request req(std::string(METHOD_NAME), 0);
+  ASSERT_EQ(LNR_ENOTCONN, pool.Send(req).Code());
+
+  // not connected yet
+  TCPSocket cs = cl.CreateSocket(TEST_ADDR, TEST_PORT);
+  pool.Add(cs);
+  pool.Add(cs);
+  ASSERT_EQ(1U, pool.GetMembers().size());
+  ASSERT_EQ(-1, pool.Select().GetId());
+  ASSERT_EQ(0U, cs.GetOutstandingRequests());
+
+  pool.Remove(cs);
+  ASSERT_TRUE(pool.GetMembers().empty());
+}
+
+TEST_F(ClientPoolTest, policies) {
+  shared_ptr<MockHandler> sh = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPServer sv(sh);
+  shared_ptr<MockHandler> ch = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl(ch);
+  TCPSocket cs1 = cl.CreateSocket(TEST_ADDR, TEST_PORT);
+  TCPSocket cs2 = cl.CreateSocket(TEST_ADDR, TEST_PORT);
+
+  Error e;
+  for (int i = 0; i < 3; i++) {
+    e = sv.Start(TEST_ADDR, TEST_PORT);
+    if (e == linear::Error(LNR_OK)) {
+      break;
+    }
+    msleep(100);
+  }
+  ASSERT_EQ(LNR_OK, e.Code());
+
+  // server never responds
+  EXPECT_CALL(*sh, OnConnectMock(_)).Times(2);
+  EXPECT_CALL(*sh, OnMessageMock(_, _)).Times(AnyNumber());
+  EXPECT_CALL(*sh, OnDisconnectMock(_, _)).Times(AnyNumber());
+  EXPECT_CALL(*ch, OnConnectMock(_)).Times(2);
+  EXPECT_CALL(*ch, OnErrorMock(_, _, _)).Times(AnyNumber());
+  EXPECT_CALL(*ch, OnDisconnectMock(_, _)).Times(AnyNumber());
+
+  ASSERT_EQ(LNR_OK, cs1.Connect().Code());
+  ASSERT_EQ(LNR_OK, cs2.Connect().Code());
+  while (cs1.GetState() != Socket::CONNECTED || cs2.GetState() != Socket::CONNECTED) {
+    msleep(1);
+  }
+
+  ClientPool pool(ClientPool::ROUND_ROBIN);
+  pool.Add(cs1);
+  pool.Add(cs2);
+  for (int i = 0; i < 4; i++) {
+    Request req(std::string(METHOD_NAME), i);
+    ASSERT_EQ(LNR_OK, pool.Send(req, 30000).Code());
+  }
+  ASSERT_EQ(2U, cs1.GetOutstandingRequests());
+  ASSERT_EQ(2U, cs2.GetOutstandingRequests());
+
+  Request req(std::string(METHOD_NAME), 0);
+  ASSERT_EQ(LNR_OK, req.Send(cs1, 30000).Code());
+  pool.SetPolicy(ClientPool::LEAST_OUTSTANDING);
+  ASSERT_EQ(cs2, pool.Select());
+  pool.SetPolicy(ClientPool::POWER_OF_TWO_CHOICES);
+  ASSERT_EQ(cs2, pool.Select()); // two members: both are always compared
+
+  pool.Eject(cs2);
+  ASSERT_EQ(cs1, pool.Select());
+  pool.Eject(cs1); // all ejected: ejection is ignored
+  ASSERT_NE(-1, pool.Select().GetId());
+
+  cs1.Disconnect();
+  cs2.Disconnect();
+  while (cs1.GetState() != Socket::DISCONNECTED || cs2.GetState() != Socket::DISCONNECTED) {
+    msleep(1);
+  }
+  ASSERT_EQ(-1, pool.Select().GetId());
+  sv.Stop();
+}
+
+MATCHER_P(IsRequestWith, params, "") {
+  return (arg.type == linear::REQUEST && arg.template as<linear::Request>().params == linear::type::any(params));
+}
+
+ACTION(SendErrorResponse) {
+  linear::Socket s = arg0;
+  const linear::Message& m = arg1;
+  const linear::Request& req = m.as<linear::Request>();
+  linear::Response resp(req.msgid, linear::type::nil(), std::string("error"));
+  resp.Send(s);
+}
+
+// requests sent through the pool eject their member when they time out or get error responses
+TEST_F(ClientPoolTest, ejectByRequestFailures) {
+  shared_ptr<MockHandler> sh = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPServer sv(sh);
+  shared_ptr<MockHandler> ch = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl(ch);
+  TCPSocket cs1 = cl.CreateSocket(TEST_ADDR, TEST_PORT);
+  TCPSocket cs2 = cl.CreateSocket(TEST_ADDR, TEST_PORT);
+
+  Error e;
+  for (int i = 0; i < 3; i++) {
+    e = sv.Start(TEST_ADDR, TEST_PORT);
+    if (e == linear::Error(LNR_OK)) {
+      break;
+    }
+    msleep(100);
+  }
+  ASSERT_EQ(LNR_OK, e.Code());
+
+  // the server answers requests with params 1 by errors, and never answers others
+  EXPECT_CALL(*sh, OnConnectMock(_)).Times(2);
+  EXPECT_CALL(*sh, OnMessageMock(_, _)).Times(AnyNumber());
+  EXPECT_CALL(*sh, OnMessageMock(_, IsRequestWith(1)))
+    .WillRepeatedly(SendErrorResponse());
+  EXPECT_CALL(*sh, OnDisconnectMock(_, _)).Times(AnyNumber());
+  EXPECT_CALL(*ch, OnConnectMock(_)).Times(2);
+  EXPECT_CALL(*ch, OnMessageMock(_, _)).Times(AnyNumber());
+  EXPECT_CALL(*ch, OnErrorMock(_, _, _)).Times(AnyNumber());
+  EXPECT_CALL(*ch, OnDisconnectMock(_, _)).Times(AnyNumber());
+
+  ASSERT_EQ(LNR_OK, cs1.Connect().Code());
+  ASSERT_EQ(LNR_OK, cs2.Connect().Code());
+  while (cs1.GetState() != Socket::CONNECTED || cs2.GetState() != Socket::CONNECTED) {
+    msleep(1);
+  }
+
+  ClientPool pool(ClientPool::ROUND_ROBIN);
+  pool.SetEjection(1, 60000);
+  pool.Add(cs1);
+  pool.Add(cs2);
+
+  // timeout: the first member is chosen first
+  Request timed_out(std::string(METHOD_NAME), 0);
+  ASSERT_EQ(LNR_OK, pool.Send(timed_out, 50).Code());
+  for (int i = 0; i < 1000 && cs1.GetOutstandingRequests() > 0; i++) {
+    msleep(1);
+  }
+  ASSERT_EQ(0U, cs1.GetOutstandingRequests());
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(cs2, pool.Select());
+  }
+
+  // error response: the second member is ejected, and the first comes back without ejection
+  pool.Remove(cs1);
+  Request failed(std::string(METHOD_NAME), 1);
+  ASSERT_EQ(LNR_OK, pool.Send(failed, 30000).Code());
+  for (int i = 0; i < 1000 && cs2.GetOutstandingRequests() > 0; i++) {
+    msleep(1);
+  }
+  ASSERT_EQ(0U, cs2.GetOutstandingRequests());
+  pool.Add(cs1);
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(cs1, pool.Select());
+  }
+
+  // requests sent to a member directly are not counted
+  Request direct(std::string(METHOD_NAME), 1);
+  ASSERT_EQ(LNR_OK, direct.Send(cs1, 30000).Code());
+  for (int i = 0; i < 1000 && cs1.GetOutstandingRequests() > 0; i++) {
+    msleep(1);
+  }
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(cs1, pool.Select());
+  }
+
+  cs1.Disconnect();
+  cs2.Disconnect();
+  while (cs1.GetState() != Socket::DISCONNECTED || cs2.GetState() != Socket::DISCONNECTED) {
+    msleep(1);
+  }
+  sv.Stop();
+}
@@ -0,0 +1,89 @@
+#include "test_common.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "linear/tcp_client.h"
+
+using namespace linear;
+
+typedef LinearTest GroupTest;
+
+TEST_F(GroupTest, joinLeave) {
+  shared_ptr<MockHandler> ch = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl(ch);
+  TCPSocket s1 = cl.CreateSocket(TEST_ADDR, TEST_PORT);
+  TCPSocket s2 = cl.CreateSocket(TEST_ADDR, TEST_PORT);
+
+  Group::Join(GROUP_NAME, s1);
+  Group::Join(GROUP_NAME, s2);
+  Group::Join(GROUP_NAME, s2);
+  Group::Join(GROUP_NAME "2", s2);
+  ASSERT_EQ(2, static_cast<int>(Group::Get(GROUP_NAME).size()));
+  ASSERT_EQ(1, static_cast<int>(Group::Get(GROUP_NAME "2").size()));
+
+  std::vector<std::string> names = Group::Names();
+  ASSERT_EQ(1, std::count(names.begin(), names.end(), std::string(GROUP_NAME)));
+  ASSERT_EQ(1, std::count(names.begin(), names.end(), std::string(GROUP_NAME "2")));
+
+  Group::Leave(GROUP_NAME, s1);
+  ASSERT_EQ(1, static_cast<int>(Group::Get(GROUP_NAME).size()));
+  ASSERT_EQ(0, static_cast<int>(Group::Get(GROUP_NAME).count(s1)));
+
+  Group::LeaveAll(s2);
+  ASSERT_TRUE(Group::Get(GROUP_NAME).empty());
+  ASSERT_TRUE(Group::Get(GROUP_NAME "2").empty());
+  ASSERT_TRUE(Group::Get("unknown").empty());
+}
+
+TEST_F(GroupTest, snapshot) {
+  shared_ptr<MockHandler> ch = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl(ch);
+  TCPSocket s1 = cl.CreateSocket(TEST_ADDR, TEST_PORT);
+  TCPSocket s2 = cl.CreateSocket(TEST_ADDR, TEST_PORT);
+
+  Group::Snapshot unknown = Group::GetSnapshot("unknown");
+  ASSERT_TRUE(unknown);
+  ASSERT_TRUE(unknown->empty());
+
+  Group::Join(GROUP_NAME, s1);
+  Group::Snapshot before = Group::GetSnapshot(GROUP_NAME);
+  ASSERT_EQ(before, Group::GetSnapshot(GROUP_NAME)); // no copy while unchanged
+
+  Group::Join(GROUP_NAME, s2);
+  Group::Snapshot after = Group::GetSnapshot(GROUP_NAME);
+  ASSERT_EQ(1, static_cast<int>(before->size())); // not modified by Join
+  ASSERT_EQ(2, static_cast<int>(after->size()));
+
+  Group::LeaveAll(s1);
+  Group::LeaveAll(s2);
+  ASSERT_EQ(2, static_cast<int>(after->size())); // not modified by Leave
+  ASSERT_TRUE(Group::GetSnapshot(GROUP_NAME)->empty());
+}
+
+TEST_F(GroupTest, snapshotAfterBurst) {
+  shared_ptr<MockHandler> ch = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl(ch);
+  std::vector<TCPSocket> sockets;
+  for (int i = 0; i < 100; i++) {
+    sockets.push_back(cl.CreateSocket(TEST_ADDR, TEST_PORT));
+  }
+  Group::Snapshot before = Group::GetSnapshot(GROUP_NAME);
+  for (std::vector<TCPSocket>::iterator it = sockets.begin(); it != sockets.end(); it++) {
+    Group::Join(GROUP_NAME, *it);
+  }
+  ASSERT_TRUE(before->empty());
+  Group::Snapshot after = Group::GetSnapshot(GROUP_NAME);
+  ASSERT_EQ(100, static_cast<int>(after->size()));
+  ASSERT_EQ(after, Group::GetSnapshot(GROUP_NAME));
+
+  Group::Leave(GROUP_NAME, sockets[0]);
+  ASSERT_EQ(100, static_cast<int>(after->size()));
+  ASSERT_EQ(99, static_cast<int>(Group::GetSnapshot(GROUP_NAME)->size()));
+  ASSERT_EQ(99, static_cast<int>(Group::Get(GROUP_NAME).size()));
+  for (std::vector<TCPSocket>::iterator it = sockets.begin(); it != sockets.end(); it++) {
+    Group::LeaveAll(*it);
+  }
+  ASSERT_TRUE(Group::GetSnapshot(GROUP_NAME)->empty());
+}
@@ -0,0 +1,97 @@
+#include "gtest/gtest.h"
+
+#include "test_common.h"
+
+#include <sstream>
+
+#include "latency_stats.h"
+
+typedef LinearTest LatencyStatsTest;
+
+TEST_F(LatencyStatsTest, buckets) {
+  // every value falls into a bucket whose upper bound is within 1/SUB_BUCKETS of it
+  size_t buckets = linear::LatencyHistogram::BUCKETS;
+  for (uint64_t v = 0; v < (static_cast<uint64_t>(1) << 37); v = v * 9 / 8 + 1) {
+    size_t index = linear::LatencyHistogram::Index(v);
+    ASSERT_GT(buckets, index);
+    uint64_t upper = linear::LatencyHistogram::UpperBound(index);
+    ASSERT_LE(v, upper);
+    ASSERT_GE(v + v / linear::LatencyHistogram::SUB_BUCKETS, upper);
+    if (index > 0) {
+      ASSERT_LT(linear::LatencyHistogram::UpperBound(index - 1), v);
+    }
+  }
+  ASSERT_EQ(buckets - 1, linear::LatencyHistogram::Index(~static_cast<uint64_t>(0)));
+}
+
+TEST_F(LatencyStatsTest, percentiles) {
+  linear::LatencyHistogram histogram;
+  linear::Latency latency;
+  histogram.Snapshot(&latency, false);
+  ASSERT_EQ(0U, latency.count);
+  ASSERT_EQ(0U, latency.p999);
+
+  for (uint64_t v = 1; v <= 10000; v++) {
+    histogram.Record(v);
+  }
+  histogram.Snapshot(&latency, false);
+  ASSERT_EQ(10000U, latency.count);
+  ASSERT_EQ(5000U, latency.mean);
+  ASSERT_EQ(1U, latency.minimum);
+  ASSERT_EQ(10000U, latency.maximum);
+  ASSERT_NEAR(5000.0, static_cast<double>(latency.p50), 5000.0 / 32);
+  ASSERT_NEAR(9000.0, static_cast<double>(latency.p90), 9000.0 / 32);
+  ASSERT_NEAR(9900.0, static_cast<double>(latency.p99), 9900.0 / 32);
+  ASSERT_NEAR(9990.0, static_cast<double>(latency.p999), 9990.0 / 32);
+  ASSERT_GE(latency.maximum, latency.p999);
+
+  // reset takes the samples away
+  histogram.Snapshot(&latency, true);
+  ASSERT_EQ(10000U, latency.count);
+  histogram.Snapshot(&latency, false);
+  ASSERT_EQ(0U, latency.count);
+  histogram.Record(7);
+  histogram.Snapshot(&latency, false);
+  ASSERT_EQ(1U, latency.count);
+  ASSERT_EQ(7U, latency.minimum);
+  ASSERT_EQ(7U, latency.p50);
+  ASSERT_EQ(7U, latency.p999);
+}
+
+TEST_F(LatencyStatsTest, recorder) {
+  linear::LatencyRecorder recorder;
+  ASSERT_FALSE(recorder.IsEnabled());
+  recorder.SetEnabled(true);
+  ASSERT_TRUE(recorder.IsEnabled());
+
+  recorder.RecordServiceTime("foo", 100);
+  recorder.RecordServiceTime("foo", 300);
+  recorder.RecordRoundTrip("bar", 1000);
+
+  linear::MethodLatencies latencies;
+  recorder.Snapshot(&latencies, true);
+  ASSERT_EQ(2U, latencies.size());
+  ASSERT_EQ(2U, latencies["foo"].service_time.count);
+  ASSERT_EQ(200U, latencies["foo"].service_time.mean);
+  ASSERT_EQ(0U, latencies["foo"].round_trip.count);
+  ASSERT_EQ(1U, latencies["bar"].round_trip.count);
+  ASSERT_EQ(1000U, latencies["bar"].round_trip.maximum);
+
+  // methods stay after reset
+  recorder.Snapshot(&latencies, false);
+  ASSERT_EQ(2U, latencies.size());
+  ASSERT_EQ(0U, latencies["foo"].service_time.count);
+}
+
+TEST_F(LatencyStatsTest, tooManyMethods) {
+  linear::LatencyRecorder recorder;
+  for (size_t i = 0; i < linear::LatencyRecorder::MAX_METHODS + 10; i++) {
+    std::ostringstream method;
+    method << "method" << i;
+    recorder.RecordServiceTime(method.str(), i);
+  }
+  linear::MethodLatencies latencies;
+  recorder.Snapshot(&latencies, false);
+  ASSERT_EQ(linear::LatencyRecorder::MAX_METHODS + 1, latencies.size());
+  ASSERT_EQ(10U, latencies[""].service_time.count);
+}
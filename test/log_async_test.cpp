@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <unistd.h>
+#endif
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "linear/log.h"
+
+#include "uv.h"
+
+using namespace linear::log;
+
+static void SleepUsec(unsigned int usec) {
+#ifdef _WIN32
+  Sleep((usec + 999) / 1000);
+#else
+  usleep(usec);
+#endif
+}
+
+class LinearLogAsyncTest : public testing::Test {
+protected:
+  LinearLogAsyncTest() {}
+  ~LinearLogAsyncTest() {}
+  virtual void SetUp() {
+    g_count = 0;
+    g_delay = 0;
+    g_last = "";
+    g_next.clear();
+    g_disordered = 0;
+    SetLevel(LOG_DEBUG);
+    EnableCallback(OnLog);
+  }
+  virtual void TearDown() {
+    DisableAsync();
+    DisableCallback();
+    SetLevel(LOG_OFF);
+  }
+
+  static void OnLog(linear::log::Level, const char*, int, const char*, const char* message) {
+    if (g_delay > 0) {
+      SleepUsec(g_delay);
+    }
+    g_count++;
+    g_last = message;
+    int producer, sequence;
+    if (sscanf(message, "producer %d: %d", &producer, &sequence) == 2) {
+      // called on the writer thread only
+      if (producer >= 0 && static_cast<size_t>(producer) < g_next.size() && g_next[producer] == sequence) {
+        g_next[producer]++;
+      } else {
+        g_disordered++;
+      }
+    }
+  }
+
+  static size_t g_count;
+  static unsigned int g_delay;
+  static std::string g_last;
+  static std::vector<int> g_next; // next sequence expected from each producer
+  static size_t g_disordered;
+};
+
+size_t LinearLogAsyncTest::g_count;
+unsigned int LinearLogAsyncTest::g_delay;
+std::string LinearLogAsyncTest::g_last;
+std::vector<int> LinearLogAsyncTest::g_next;
+size_t LinearLogAsyncTest::g_disordered;
+
+TEST_F(LinearLogAsyncTest, writeAll) {
+  ASSERT_TRUE(EnableAsync(1024, true));
+  for (int i = 0; i < 10000; i++) {
+    LINEAR_LOG(LOG_DEBUG, "log %d", i);
+  }
+  DisableAsync();
+  ASSERT_EQ(10000u, g_count);
+  ASSERT_EQ(std::string("log 9999"), g_last);
+
+  // written directly again
+  LINEAR_LOG(LOG_DEBUG, "sync");
+  ASSERT_EQ(10001u, g_count);
+}
+
+TEST_F(LinearLogAsyncTest, drop) {
+  size_t dropped = GetDroppedLogs();
+  g_delay = 1000;
+  ASSERT_TRUE(EnableAsync(4, false));
+  for (int i = 0; i < 100; i++) {
+    LINEAR_LOG(LOG_DEBUG, "log %d", i);
+  }
+  DisableAsync();
+  ASSERT_LT(0u, GetDroppedLogs() - dropped);
+  ASSERT_EQ(100u, g_count + GetDroppedLogs() - dropped);
+}
+
+TEST_F(LinearLogAsyncTest, block) {
+  size_t dropped = GetDroppedLogs();
+  g_delay = 100;
+  ASSERT_TRUE(EnableAsync(4, true));
+  for (int i = 0; i < 100; i++) {
+    LINEAR_LOG(LOG_DEBUG, "log %d", i);
+  }
+  DisableAsync();
+  ASSERT_EQ(dropped, GetDroppedLogs());
+  ASSERT_EQ(100u, g_count);
+  ASSERT_EQ(std::string("log 99"), g_last);
+}
+
+static const int PRODUCERS = 8;
+static const int RECORDS = 5000;
+
+static void Produce(void* args) {
+  int producer = *static_cast<int*>(args);
+  for (int i = 0; i < RECORDS; i++) {
+    LINEAR_LOG(LOG_DEBUG, "producer %d: %d", producer, i);
+  }
+}
+
+// every record arrives exactly once, and in order per producer
+TEST_F(LinearLogAsyncTest, multiProducer) {
+  g_next.assign(PRODUCERS, 0);
+  ASSERT_TRUE(EnableAsync(64, true));
+  uv_thread_t threads[PRODUCERS];
+  int producers[PRODUCERS];
+  for (int i = 0; i < PRODUCERS; i++) {
+    producers[i] = i;
+    ASSERT_EQ(0, uv_thread_create(&threads[i], Produce, &producers[i]));
+  }
+  for (int i = 0; i < PRODUCERS; i++) {
+    uv_thread_join(&threads[i]);
+  }
+  DisableAsync();
+  ASSERT_EQ(static_cast<size_t>(PRODUCERS * RECORDS), g_count);
+  ASSERT_EQ(0u, g_disordered);
+  for (int i = 0; i < PRODUCERS; i++) {
+    ASSERT_EQ(RECORDS, g_next[i]);
+  }
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
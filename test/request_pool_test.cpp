@@ -0,0 +1,35 @@
+#include "gtest/gtest.h"
+
+#include "test_common.h"
+
+#include <vector>
+
+#include "request_pool.h"
+
+typedef LinearTest RequestPoolTest;
+
+struct Entry {
+  linear::Request request;
+};
+
+TEST_F(RequestPoolTest, addRemove) {
+  linear::RequestPool<Entry> pool;
+  Entry e1, e2, e3;
+  e3.request = e1.request; // same msgid
+
+  pool.Add(&e1);
+  pool.Add(&e2);
+  pool.Add(&e3);
+  ASSERT_EQ(3, static_cast<int>(pool.Size()));
+
+  ASSERT_TRUE(pool.Remove(&e3));
+  ASSERT_FALSE(pool.Remove(&e3));
+  ASSERT_EQ(&e1, pool.Remove(e1.request.msgid));
+  ASSERT_EQ(NULL, pool.Remove(e1.request.msgid));
+
+  std::vector<Entry*> entries;
+  pool.RemoveAll(&entries);
+  ASSERT_EQ(1, static_cast<int>(entries.size()));
+  ASSERT_EQ(&e2, entries[0]);
+  ASSERT_EQ(0, static_cast<int>(pool.Size()));
+}
@@ -0,0 +1,117 @@
+#include "gtest/gtest.h"
+
+#include "test_common.h"
+
+#include <map>
+#include <string>
+
+#include "linear/addrinfo.h"
+
+#include "resolver.h"
+
+// stands in for /etc/hosts, so that the tests do not depend on DNS
+static std::map<std::string, linear::Addrinfo::Protocol> g_hosts;
+static int g_resolved = 0;
+
+static int ResolveByHosts(const std::string& host, linear::Addrinfo::Protocol* proto, std::string* address) {
+  g_resolved++;
+  std::map<std::string, linear::Addrinfo::Protocol>::iterator it = g_hosts.find(host);
+  if (it == g_hosts.end()) {
+    return -1;
+  }
+  *proto = it->second;
+  *address = (it->second == linear::Addrinfo::IPv4) ? "192.0.2.1" : "2001:db8::1";
+  return 0;
+}
+
+class ResolverTest : public LinearTest {
+ public:
+  virtual void SetUp() {
+    LinearTest::SetUp();
+    g_hosts.clear();
+    g_hosts["v4.linear.test"] = linear::Addrinfo::IPv4;
+    g_hosts["v6.linear.test"] = linear::Addrinfo::IPv6;
+    g_resolved = 0;
+    linear::Resolver::SetFunction(ResolveByHosts);
+  }
+  virtual void TearDown() {
+    linear::Resolver::SetFunction(NULL);
+    linear::Resolver::SetTTL(linear::Resolver::DEFAULT_TTL);
+    LinearTest::TearDown();
+  }
+};
+
+TEST_F(ResolverTest, numeric) {
+  ASSERT_EQ(linear::Addrinfo::IPv4, linear::Resolver::Resolve("127.0.0.1"));
+  ASSERT_EQ(linear::Addrinfo::IPv6, linear::Resolver::Resolve("::1"));
+  std::string address;
+  ASSERT_EQ(linear::Addrinfo::IPv4, linear::Resolver::Resolve("127.0.0.1", &address));
+  ASSERT_EQ("127.0.0.1", address);
+  ASSERT_EQ("::1", linear::Resolver::GetAddress("::1"));
+  ASSERT_EQ(0, g_resolved);
+}
+
+TEST_F(ResolverTest, cache) {
+  linear::Addrinfo::Protocol proto;
+  ASSERT_FALSE(linear::Resolver::Lookup("v4.linear.test", &proto));
+
+  linear::Addrinfo ai("v4.linear.test", 10000);
+  ASSERT_EQ("v4.linear.test", ai.addr);
+  ASSERT_EQ(10000, ai.port);
+  ASSERT_EQ(linear::Addrinfo::IPv4, ai.proto);
+  ASSERT_EQ(linear::Addrinfo::IPv6, linear::Resolver::Resolve("v6.linear.test"));
+  ASSERT_EQ(2, g_resolved);
+
+  std::string address;
+  ASSERT_TRUE(linear::Resolver::Lookup("v4.linear.test", &proto, &address));
+  ASSERT_EQ(linear::Addrinfo::IPv4, proto);
+  ASSERT_EQ("192.0.2.1", address);
+  ASSERT_EQ(linear::Addrinfo::IPv6, linear::Resolver::Resolve("v6.linear.test", &address));
+  ASSERT_EQ("2001:db8::1", address);
+  // what tv_connect and tv_listen get: no DNS in libtv for cached hosts
+  ASSERT_EQ("2001:db8::1", linear::Resolver::GetAddress("v6.linear.test"));
+  ASSERT_EQ(2, g_resolved);
+
+  linear::Resolver::Clear();
+  ASSERT_EQ(linear::Addrinfo::IPv4, linear::Resolver::Resolve("v4.linear.test"));
+  ASSERT_EQ(3, g_resolved);
+}
+
+TEST_F(ResolverTest, negative) {
+  linear::Addrinfo ai("unknown.linear.test", 10000);
+  ASSERT_EQ(linear::Addrinfo::UNKNOWN, ai.proto);
+  ASSERT_EQ(1, g_resolved);
+
+  linear::Addrinfo::Protocol proto = linear::Addrinfo::IPv4;
+  ASSERT_TRUE(linear::Resolver::Lookup("unknown.linear.test", &proto));
+  ASSERT_EQ(linear::Addrinfo::UNKNOWN, proto);
+  ASSERT_EQ(linear::Addrinfo::UNKNOWN, linear::Resolver::Resolve("unknown.linear.test"));
+  // left to libtv, which reports the failure at connect
+  ASSERT_EQ("unknown.linear.test", linear::Resolver::GetAddress("unknown.linear.test"));
+  ASSERT_EQ(1, g_resolved);
+}
+
+TEST_F(ResolverTest, ttl) {
+  linear::Resolver::SetTTL(0); // no cache
+  ASSERT_EQ(linear::Addrinfo::IPv4, linear::Resolver::Resolve("v4.linear.test"));
+  ASSERT_EQ(linear::Addrinfo::IPv4, linear::Resolver::Resolve("v4.linear.test"));
+  ASSERT_EQ(2, g_resolved);
+
+  linear::Resolver::SetTTL(50);
+  ASSERT_EQ(linear::Addrinfo::IPv4, linear::Resolver::Resolve("v4.linear.test"));
+  ASSERT_EQ(linear::Addrinfo::IPv4, linear::Resolver::Resolve("v4.linear.test"));
+  ASSERT_EQ(3, g_resolved);
+  msleep(100);
+  ASSERT_EQ(linear::Addrinfo::IPv4, linear::Resolver::Resolve("v4.linear.test"));
+  ASSERT_EQ(4, g_resolved);
+}
+
+TEST_F(ResolverTest, store) {
+  ASSERT_EQ("v6.linear.test", linear::Resolver::GetAddress("v6.linear.test"));
+  linear::Resolver::Store("v6.linear.test", linear::Addrinfo::IPv6, "2001:db8::2");
+  std::string address;
+  ASSERT_EQ(linear::Addrinfo::IPv6, linear::Resolver::Resolve("v6.linear.test", &address));
+  ASSERT_EQ("2001:db8::2", address);
+  ASSERT_EQ("2001:db8::2", linear::Resolver::GetAddress("v6.linear.test"));
+  ASSERT_EQ(0, g_resolved);
+}
@@ -141,6 +141,37 @@ TEST_F(TCPClientServerConnectionTest, ConnectEinval) {
   ASSERT_EQ(LNR_EINVAL, e.Code());
 }
 
+// Backlog
+TEST_F(TCPClientServerConnectionTest, Backlog) {
+  shared_ptr<MockHandler> sh = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPServer sv(sh);
+  shared_ptr<MockHandler> ch = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl(ch);
+  TCPSocket cs = cl.CreateSocket(TEST_ADDR, TEST_PORT);
+
+  Error e = sv.SetBacklog(0);
+  ASSERT_EQ(LNR_EINVAL, e.Code());
+  e = sv.SetBacklog(1024);
+  ASSERT_EQ(LNR_OK, e.Code());
+  for (int i = 0; i < 3; i++) {
+    e = sv.Start(TEST_ADDR, TEST_PORT);
+    if (e == linear::Error(LNR_OK)) {
+      break;
+    }
+    msleep(100);
+  }
+  ASSERT_EQ(LNR_OK, e.Code());
+
+  EXPECT_CALL(*sh, OnConnectMock(_))
+    .WillOnce(Assign(&srv_connected, true));
+  EXPECT_CALL(*ch, OnConnectMock(cs))
+    .WillOnce(Assign(&cli_connected, true));
+
+  e = cs.Connect();
+  ASSERT_EQ(LNR_OK, e.Code());
+  WAIT_CONNECTED();
+}
+
 // Connect - Disconnect from Client in front thread
 TEST_F(TCPClientServerConnectionTest, DisconnectFromClientFT) {
   shared_ptr<MockHandler> sh = linear::shared_ptr<MockHandler>(new MockHandler());
@@ -335,6 +366,146 @@ TEST_F(TCPClientServerConnectionTest, Reconnect) {
   WAIT_TESTED();
 }
 
+// Auto Reconnect: Notify sent while waiting is delivered after reconnect
+TEST_F(TCPClientServerConnectionTest, AutoReconnect) {
+  shared_ptr<MockHandler> sh = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPServer sv(sh);
+  shared_ptr<MockHandler> ch = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl(ch);
+  TCPSocket cs = cl.CreateSocket(TEST_ADDR, TEST_PORT);
+
+  Socket::ReconnectPolicy policy;
+  policy.initial_delay = 200;
+  policy.jitter = 0;
+  Error e = cs.SetReconnect(true, policy);
+  ASSERT_EQ(LNR_OK, e.Code());
+
+  {
+    InSequence dummy;
+    EXPECT_CALL(*sh, OnConnectMock(_));
+    EXPECT_CALL(*sh, OnMessageMock(Eq(ByRef(sh->s_)), _))
+      .WillOnce(Assign(&srv_tested, true));
+    EXPECT_CALL(*sh, OnDisconnectMock(Eq(ByRef(sh->s_)), _))
+      .WillOnce(Assign(&srv_tested, true));
+  }
+  bool refused = false;
+  {
+    InSequence dummy;
+    EXPECT_CALL(*ch, OnDisconnectMock(cs, _))
+      .WillOnce(Assign(&refused, true));
+    EXPECT_CALL(*ch, OnConnectMock(cs))
+      .WillOnce(Assign(&cli_tested, true));
+    EXPECT_CALL(*ch, OnDisconnectMock(cs, Error(LNR_OK)))
+      .WillOnce(Assign(&cli_tested, true));
+  }
+
+  e = cs.Connect();
+  ASSERT_EQ(LNR_OK, e.Code());
+  while (!refused) { // waiting to reconnect from now on
+    msleep(1);
+  }
+  Notify notif(std::string(METHOD_NAME), Params());
+  e = notif.Send(cs);
+  ASSERT_EQ(LNR_OK, e.Code());
+  Request request(std::string(METHOD_NAME), Params());
+  e = request.Send(cs);
+  ASSERT_EQ(LNR_ENOTCONN, e.Code());
+
+  for (int i = 0; i < 3; i++) {
+    e = sv.Start(TEST_ADDR, TEST_PORT);
+    if (e == linear::Error(LNR_OK)) {
+      break;
+    }
+    msleep(100);
+  }
+  ASSERT_EQ(LNR_OK, e.Code());
+  WAIT_TESTED();
+
+  // check message in server side
+  ASSERT_TRUE(sh->m_ != NULL);
+  ASSERT_EQ(NOTIFY, sh->m_->type);
+  ASSERT_EQ(notif.method, sh->m_->as<Notify>().method);
+
+  // Disconnect stops reconnecting
+  srv_tested = cli_tested = false;
+  e = cs.Disconnect();
+  ASSERT_EQ(LNR_OK, e.Code());
+  WAIT_TESTED();
+}
+
+// Auto Reconnect: gives up after max_attempts and cancels the outbox
+TEST_F(TCPClientServerConnectionTest, AutoReconnectGiveUp) {
+  shared_ptr<MockHandler> ch = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl(ch);
+  TCPSocket cs = cl.CreateSocket(TEST_ADDR, TEST_PORT + 5);
+
+  Socket::ReconnectPolicy policy;
+  policy.initial_delay = 10;
+  policy.jitter = 0;
+  policy.max_attempts = 2;
+  Error e = cs.SetReconnect(true, policy);
+  ASSERT_EQ(LNR_OK, e.Code());
+
+  EXPECT_CALL(*ch, OnConnectMock(_))
+    .Times(0);
+  {
+    InSequence dummy;
+    EXPECT_CALL(*ch, OnDisconnectMock(cs, _)) // refused, then held until giving up
+      .WillOnce(WithArg<0>(SendNotify()));
+    EXPECT_CALL(*ch, OnDisconnectMock(cs, _)); // 1st attempt
+    EXPECT_CALL(*ch, OnErrorMock(cs, _, Error(LNR_ECANCELED)));
+    EXPECT_CALL(*ch, OnDisconnectMock(cs, _)) // 2nd attempt, the last one
+      .WillOnce(Assign(&cli_tested, true));
+  }
+
+  e = cs.Connect();
+  ASSERT_EQ(LNR_OK, e.Code());
+  WAIT_CLI_TESTED();
+
+  // not reconnecting any more
+  Notify notif(std::string(METHOD_NAME), Params());
+  e = notif.Send(cs);
+  ASSERT_EQ(LNR_ENOTCONN, e.Code());
+}
+
+// Auto Reconnect: Notify beyond max_outbox fails with LNR_ENOBUFS
+TEST_F(TCPClientServerConnectionTest, AutoReconnectOutboxFull) {
+  shared_ptr<MockHandler> ch = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl(ch);
+  TCPSocket cs = cl.CreateSocket(TEST_ADDR, TEST_PORT + 5);
+
+  Socket::ReconnectPolicy policy;
+  policy.initial_delay = 10000; // stays waiting during the test
+  policy.jitter = 0;
+  policy.max_outbox = 2;
+  Error e = cs.SetReconnect(true, policy);
+  ASSERT_EQ(LNR_OK, e.Code());
+
+  bool refused = false;
+  EXPECT_CALL(*ch, OnConnectMock(_))
+    .Times(0);
+  EXPECT_CALL(*ch, OnDisconnectMock(cs, _))
+    .WillOnce(Assign(&refused, true));
+  EXPECT_CALL(*ch, OnErrorMock(cs, _, Error(LNR_ECANCELED)))
+    .WillOnce(::testing::Return())
+    .WillOnce(Assign(&cli_tested, true));
+
+  e = cs.Connect();
+  ASSERT_EQ(LNR_OK, e.Code());
+  while (!refused) {
+    msleep(1);
+  }
+  Notify notif(std::string(METHOD_NAME), Params());
+  ASSERT_EQ(LNR_OK, notif.Send(cs).Code());
+  ASSERT_EQ(LNR_OK, notif.Send(cs).Code());
+  ASSERT_EQ(LNR_ENOBUFS, notif.Send(cs).Code());
+
+  // Disconnect stops reconnecting and cancels the held notifies
+  e = cs.Disconnect();
+  ASSERT_EQ(LNR_OK, e.Code());
+  WAIT_CLI_TESTED();
+}
+
 namespace global {
 extern linear::Socket gs_;
 }
@@ -1,7 +1,11 @@
 #include "test_common.h"
 
+#include "linear/packed_message.h"
 #include "linear/tcp_client.h"
 #include "linear/tcp_server.h"
+#include "linear/worker_pool.h"
+
+#include "shared_buffer.h"
 
 using namespace linear;
 using ::testing::_;
@@ -15,6 +19,10 @@ using ::testing::Assign;
 
 typedef LinearTest TCPClientServerSendRecvTest;
 
+ACTION_P(CountUp, counter) {
+  (*counter)++;
+}
+
 // Send Request from Client in front thread and Send Response from Server in back thread
 TEST_F(TCPClientServerSendRecvTest, RequestFromClientFTResponseFromServerBT) {
   shared_ptr<MockHandler> sh = linear::shared_ptr<MockHandler>(new MockHandler());
@@ -451,6 +459,315 @@ TEST_F(TCPClientServerSendRecvTest, NotifyFromClientFT) {
   ASSERT_EQ(notif.params, recv_notif.params);
 }
 
+// Count a Notify from Client on both sides
+TEST_F(TCPClientServerSendRecvTest, Stats) {
+  shared_ptr<MockHandler> sh = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPServer sv(sh);
+  shared_ptr<MockHandler> ch = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl(ch);
+  TCPSocket cs = cl.CreateSocket(TEST_ADDR, TEST_PORT);
+
+  Error e;
+  for (int i = 0; i < 3; i++) {
+    e = sv.Start(TEST_ADDR, TEST_PORT);
+    if (e == linear::Error(LNR_OK)) {
+      break;
+    }
+    msleep(100);
+  }
+  ASSERT_EQ(LNR_OK, e.Code());
+  ASSERT_EQ(0U, sv.GetStats().messages_in);
+
+  EXPECT_CALL(*sh, OnConnectMock(_));
+  EXPECT_CALL(*sh, OnMessageMock(Eq(ByRef(sh->s_)), _))
+    .WillOnce(WithArg<0>(Disconnect()));
+  EXPECT_CALL(*sh, OnDisconnectMock(Eq(ByRef(sh->s_)), _))
+    .WillOnce(Assign(&srv_tested, true));
+  EXPECT_CALL(*ch, OnConnectMock(cs));
+  EXPECT_CALL(*ch, OnDisconnectMock(cs, _))
+    .WillOnce(Assign(&cli_tested, true));
+
+  e = cs.Connect();
+  ASSERT_EQ(LNR_OK, e.Code());
+  Notify notif(std::string(METHOD_NAME), Params());
+  e = notif.Send(cs);
+  ASSERT_EQ(LNR_OK, e.Code());
+  WAIT_TESTED();
+
+  Stats cstats = cs.GetStats();
+  ASSERT_EQ(1U, cstats.messages_out);
+  ASSERT_LT(0U, cstats.bytes_out);
+  ASSERT_EQ(0U, cstats.messages_in);
+  ASSERT_EQ(0U, cstats.send_queue_depth);
+  ASSERT_EQ(0U, cstats.outstanding_requests);
+
+  Stats sstats = sv.GetStats();
+  ASSERT_EQ(1U, sstats.messages_in);
+  ASSERT_EQ(cstats.bytes_out, sstats.bytes_in);
+  ASSERT_EQ(0U, sstats.decode_errors);
+  ASSERT_EQ(0U, sstats.send_queue_depth);
+  ASSERT_EQ(0U, sstats.connections);
+  ASSERT_EQ(sstats.messages_in, sh->s_.GetStats().messages_in);
+}
+
+// Record latencies of a Request from Client
+TEST_F(TCPClientServerSendRecvTest, LatencyStats) {
+  shared_ptr<MockHandler> sh = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPServer sv(sh);
+  shared_ptr<MockHandler> ch = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl(ch);
+  TCPSocket cs = cl.CreateSocket(TEST_ADDR, TEST_PORT);
+
+  Error e;
+  for (int i = 0; i < 3; i++) {
+    e = sv.Start(TEST_ADDR, TEST_PORT);
+    if (e == linear::Error(LNR_OK)) {
+      break;
+    }
+    msleep(100);
+  }
+  ASSERT_EQ(LNR_OK, e.Code());
+  ASSERT_EQ(LNR_OK, sv.SetLatencyStats(true).Code());
+  ASSERT_EQ(LNR_OK, cl.SetLatencyStats(true).Code());
+
+  EXPECT_CALL(*sh, OnConnectMock(_));
+  EXPECT_CALL(*sh, OnMessageMock(Eq(ByRef(sh->s_)), _))
+    .WillOnce(WithArgs<0, 1>(SendResponse()));
+  EXPECT_CALL(*sh, OnDisconnectMock(_, _))
+    .WillOnce(Assign(&srv_tested, true));
+  EXPECT_CALL(*ch, OnConnectMock(cs));
+  EXPECT_CALL(*ch, OnMessageMock(cs, _))
+    .WillOnce(WithArgs<0>(Disconnect()));
+  EXPECT_CALL(*ch, OnDisconnectMock(_, _))
+    .WillOnce(Assign(&cli_tested, true));
+
+  e = cs.Connect();
+  ASSERT_EQ(LNR_OK, e.Code());
+  Request req(std::string(METHOD_NAME), Params());
+  e = req.Send(cs);
+  ASSERT_EQ(LNR_OK, e.Code());
+  WAIT_TESTED();
+
+  MethodLatencies slatencies = sv.GetLatencyStats(true);
+  ASSERT_EQ(1U, slatencies.size());
+  ASSERT_EQ(1U, slatencies[METHOD_NAME].service_time.count);
+  ASSERT_EQ(0U, slatencies[METHOD_NAME].round_trip.count);
+  ASSERT_EQ(0U, sv.GetLatencyStats()[METHOD_NAME].service_time.count);
+
+  MethodLatencies clatencies = cl.GetLatencyStats();
+  ASSERT_EQ(1U, clatencies.size());
+  ASSERT_EQ(1U, clatencies[METHOD_NAME].round_trip.count);
+}
+
+#if !defined(MSGPACK_USE_CPP03)
+// Send moved Notify from Client in front thread
+TEST_F(TCPClientServerSendRecvTest, MovedNotifyFromClientFT) {
+  shared_ptr<MockHandler> sh = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPServer sv(sh);
+  shared_ptr<MockHandler> ch = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl(ch);
+  TCPSocket cs = cl.CreateSocket(TEST_ADDR, TEST_PORT);
+
+  Error e;
+  for (int i = 0; i < 3; i++) {
+    e = sv.Start(TEST_ADDR, TEST_PORT);
+    if (e == linear::Error(LNR_OK)) {
+      break;
+    }
+    msleep(100);
+  }
+  ASSERT_EQ(LNR_OK, e.Code());
+
+  EXPECT_CALL(*sh, OnConnectMock(_));
+  EXPECT_CALL(*sh, OnMessageMock(Eq(ByRef(sh->s_)), _))
+    .WillOnce(WithArg<0>(Disconnect()));
+  EXPECT_CALL(*sh, OnDisconnectMock(Eq(ByRef(sh->s_)), _))
+    .WillOnce(Assign(&srv_tested, true));
+  EXPECT_CALL(*ch, OnConnectMock(cs));
+  EXPECT_CALL(*ch, OnDisconnectMock(cs, _))
+    .WillOnce(Assign(&cli_tested, true));
+
+  e = cs.Connect();
+  ASSERT_EQ(LNR_OK, e.Code());
+  Notify notif(std::string(METHOD_NAME), Params());
+  Notify moved(notif);
+  e = cs.Send(std::move(moved));
+  ASSERT_EQ(LNR_OK, e.Code());
+  ASSERT_TRUE(moved.params.is_nil());
+  WAIT_TESTED();
+
+  // check message in server side
+  ASSERT_TRUE(sh->m_ != NULL);
+  ASSERT_EQ(NOTIFY, sh->m_->type);
+  Notify recv_notif = sh->m_->as<Notify>();
+  ASSERT_EQ(notif.method, recv_notif.method);
+  ASSERT_EQ(notif.params, recv_notif.params);
+}
+#endif
+
+// Send Notifies from Client in front thread with write coalescing
+TEST_F(TCPClientServerSendRecvTest, CoalescedNotifiesFromClientFT) {
+  shared_ptr<MockHandler> sh = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPServer sv(sh);
+  shared_ptr<MockHandler> ch = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl(ch);
+  TCPSocket cs = cl.CreateSocket(TEST_ADDR, TEST_PORT);
+
+  Error e;
+  for (int i = 0; i < 3; i++) {
+    e = sv.Start(TEST_ADDR, TEST_PORT);
+    if (e == linear::Error(LNR_OK)) {
+      break;
+    }
+    msleep(100);
+  }
+  ASSERT_EQ(LNR_OK, e.Code());
+
+  EXPECT_CALL(*sh, OnConnectMock(_))
+    .WillOnce(Assign(&srv_connected, true));
+  {
+    InSequence dummy;
+    EXPECT_CALL(*sh, OnMessageMock(Eq(ByRef(sh->s_)), _))
+      .Times(2);
+    EXPECT_CALL(*sh, OnMessageMock(Eq(ByRef(sh->s_)), _))
+      .WillOnce(WithArg<0>(Disconnect()));
+  }
+  EXPECT_CALL(*sh, OnDisconnectMock(Eq(ByRef(sh->s_)), _))
+    .WillOnce(Assign(&srv_tested, true));
+  EXPECT_CALL(*ch, OnConnectMock(cs))
+    .WillOnce(Assign(&cli_connected, true));
+  EXPECT_CALL(*ch, OnDisconnectMock(cs, _))
+    .WillOnce(Assign(&cli_tested, true));
+
+  e = cs.SetWriteCoalescing(true);
+  ASSERT_EQ(LNR_OK, e.Code());
+  e = cs.Connect();
+  ASSERT_EQ(LNR_OK, e.Code());
+  WAIT_CONNECTED();
+  for (int i = 0; i < 3; i++) {
+    Notify notif(std::string(METHOD_NAME), i);
+    e = notif.Send(cs);
+    ASSERT_EQ(LNR_OK, e.Code());
+  }
+  WAIT_TESTED();
+
+  // messages keep their order
+  ASSERT_TRUE(sh->m_ != NULL);
+  ASSERT_EQ(NOTIFY, sh->m_->type);
+  Notify recv_notif = sh->m_->as<Notify>();
+  ASSERT_EQ(2, recv_notif.params.as<int>());
+}
+
+// Send Notifies from Client in front thread to Server running handlers on workers
+TEST_F(TCPClientServerSendRecvTest, NotifiesToServerWithWorkerPool) {
+  shared_ptr<MockHandler> sh = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPServer sv(sh);
+  WorkerPool workers(2, 16);
+  ASSERT_EQ(LNR_OK, sv.SetWorkerPool(workers).Code());
+  shared_ptr<MockHandler> ch = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl(ch);
+  TCPSocket cs = cl.CreateSocket(TEST_ADDR, TEST_PORT);
+
+  Error e;
+  for (int i = 0; i < 3; i++) {
+    e = sv.Start(TEST_ADDR, TEST_PORT);
+    if (e == linear::Error(LNR_OK)) {
+      break;
+    }
+    msleep(100);
+  }
+  ASSERT_EQ(LNR_OK, e.Code());
+
+  EXPECT_CALL(*sh, OnConnectMock(_))
+    .WillOnce(Assign(&srv_connected, true));
+  {
+    InSequence dummy;
+    EXPECT_CALL(*sh, OnMessageMock(Eq(ByRef(sh->s_)), _))
+      .Times(2);
+    EXPECT_CALL(*sh, OnMessageMock(Eq(ByRef(sh->s_)), _))
+      .WillOnce(WithArg<0>(Disconnect()));
+  }
+  EXPECT_CALL(*sh, OnDisconnectMock(Eq(ByRef(sh->s_)), _))
+    .WillOnce(Assign(&srv_tested, true));
+  EXPECT_CALL(*ch, OnConnectMock(cs))
+    .WillOnce(Assign(&cli_connected, true));
+  EXPECT_CALL(*ch, OnDisconnectMock(cs, _))
+    .WillOnce(Assign(&cli_tested, true));
+
+  e = cs.Connect();
+  ASSERT_EQ(LNR_OK, e.Code());
+  WAIT_CONNECTED();
+  for (int i = 0; i < 3; i++) {
+    Notify notif(std::string(METHOD_NAME), i);
+    e = notif.Send(cs);
+    ASSERT_EQ(LNR_OK, e.Code());
+  }
+  WAIT_TESTED();
+
+  // messages keep their order on the strand of the socket
+  ASSERT_EQ(2U, workers.GetNumWorkers());
+  ASSERT_EQ(16U, workers.GetMaxQueueDepth());
+  ASSERT_LE(1U, workers.GetPeakQueueDepth());
+  ASSERT_TRUE(sh->m_ != NULL);
+  ASSERT_EQ(NOTIFY, sh->m_->type);
+  Notify recv_notif = sh->m_->as<Notify>();
+  ASSERT_EQ(2, recv_notif.params.as<int>());
+}
+
+// Send PackedMessage from Client in front thread twice
+TEST_F(TCPClientServerSendRecvTest, PackedNotifyFromClientFT) {
+  shared_ptr<MockHandler> sh = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPServer sv(sh);
+  shared_ptr<MockHandler> ch = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPClient cl(ch);
+  TCPSocket cs = cl.CreateSocket(TEST_ADDR, TEST_PORT);
+
+  Error e;
+  for (int i = 0; i < 3; i++) {
+    e = sv.Start(TEST_ADDR, TEST_PORT);
+    if (e == linear::Error(LNR_OK)) {
+      break;
+    }
+    msleep(100);
+  }
+  ASSERT_EQ(LNR_OK, e.Code());
+
+  EXPECT_CALL(*sh, OnConnectMock(_));
+  {
+    InSequence dummy;
+    EXPECT_CALL(*sh, OnMessageMock(Eq(ByRef(sh->s_)), _));
+    EXPECT_CALL(*sh, OnMessageMock(Eq(ByRef(sh->s_)), _))
+      .WillOnce(WithArg<0>(Disconnect()));
+  }
+  EXPECT_CALL(*sh, OnDisconnectMock(Eq(ByRef(sh->s_)), _))
+    .WillOnce(Assign(&srv_tested, true));
+  EXPECT_CALL(*ch, OnConnectMock(cs));
+  EXPECT_CALL(*ch, OnDisconnectMock(cs, _))
+    .WillOnce(Assign(&cli_tested, true));
+
+  Notify notif(std::string(METHOD_NAME), Params());
+  PackedMessage packed(notif);
+  ASSERT_TRUE(packed.GetMessage() != NULL);
+  ASSERT_EQ(NOTIFY, packed.GetMessage()->type);
+  ASSERT_LT(0U, packed.GetSize());
+  ASSERT_EQ(LNR_EINVAL, cs.Send(PackedMessage()).Code());
+
+  e = cs.Connect();
+  ASSERT_EQ(LNR_OK, e.Code());
+  e = packed.Send(cs);
+  ASSERT_EQ(LNR_OK, e.Code());
+  e = cs.Send(packed);
+  ASSERT_EQ(LNR_OK, e.Code());
+  WAIT_TESTED();
+
+  // check message in server side
+  ASSERT_TRUE(sh->m_ != NULL);
+  ASSERT_EQ(NOTIFY, sh->m_->type);
+  Notify recv_notif = sh->m_->as<Notify>();
+  ASSERT_EQ(notif.method, recv_notif.method);
+  ASSERT_EQ(notif.params, recv_notif.params);
+}
+
 // Send Notify from Server in front thread
 TEST_F(TCPClientServerSendRecvTest, NotifyFromServerFT) {
   shared_ptr<MockHandler> sh = linear::shared_ptr<MockHandler>(new MockHandler());
@@ -756,6 +1073,142 @@ TEST_F(TCPClientServerSendRecvTest, NotifyFromClientToGroup) {
   ASSERT_EQ(params, recv_notif.params);
 }
 
+// Send Notify from Server to a group of several sockets: packed once, same payload to every member
+TEST_F(TCPClientServerSendRecvTest, NotifyFromServerToGroupPackedOnce) {
+  static const int N = 4;
+  shared_ptr<MockHandler> sh = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPServer sv(sh);
+  std::vector<shared_ptr<MockHandler> > chs;
+  std::vector<TCPClient> cls;
+  std::vector<TCPSocket> css;
+  for (int i = 0; i < N; i++) {
+    chs.push_back(linear::shared_ptr<MockHandler>(new MockHandler()));
+    cls.push_back(TCPClient(chs[i]));
+    css.push_back(cls[i].CreateSocket(TEST_ADDR, TEST_PORT));
+  }
+
+  Error e;
+  for (int i = 0; i < 3; i++) {
+    e = sv.Start(TEST_ADDR, TEST_PORT);
+    if (e == linear::Error(LNR_OK)) {
+      break;
+    }
+    msleep(100);
+  }
+  ASSERT_EQ(LNR_OK, e.Code());
+
+  volatile int disconnected = 0;
+  EXPECT_CALL(*sh, OnConnectMock(_))
+    .Times(N)
+    .WillRepeatedly(WithArg<0>(JoinToGroup()));
+  EXPECT_CALL(*sh, OnDisconnectMock(_, _))
+    .Times(N);
+  for (int i = 0; i < N; i++) {
+    EXPECT_CALL(*chs[i], OnConnectMock(css[i]));
+    EXPECT_CALL(*chs[i], OnMessageMock(css[i], _))
+      .WillOnce(WithArg<0>(Disconnect()));
+    EXPECT_CALL(*chs[i], OnDisconnectMock(css[i], _))
+      .WillOnce(CountUp(&disconnected));
+    e = css[i].Connect();
+    ASSERT_EQ(LNR_OK, e.Code());
+  }
+  for (int i = 0; i < 5000 && Group::Get(GROUP_NAME).size() < static_cast<size_t>(N); i++) {
+    msleep(1);
+  }
+  ASSERT_EQ(static_cast<size_t>(N), Group::Get(GROUP_NAME).size());
+
+  size_t packed = SharedBuffer::GetPackedCount();
+  Notify notif(std::string(METHOD_NAME), Params());
+  notif.Send(GROUP_NAME);
+  ASSERT_EQ(packed + 1, SharedBuffer::GetPackedCount());
+  while (disconnected < N) {
+    msleep(1);
+  }
+  while (!Group::Get(GROUP_NAME).empty()) {
+    msleep(1);
+  }
+
+  // check messages
+  type::any params = Params();
+  for (int i = 0; i < N; i++) {
+    ASSERT_TRUE(chs[i]->m_ != NULL);
+    ASSERT_EQ(NOTIFY, chs[i]->m_->type);
+    Notify recv_notif = chs[i]->m_->as<Notify>();
+    ASSERT_EQ(notif.method, recv_notif.method);
+    ASSERT_EQ(params, recv_notif.params);
+  }
+}
+
+// Send Notify from Clients with write coalescing to a group: corked sockets queue the shared buffer
+TEST_F(TCPClientServerSendRecvTest, NotifyToCoalescingGroupPackedOnce) {
+  static const int N = 4;
+  shared_ptr<MockHandler> sh = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPServer sv(sh);
+  std::vector<shared_ptr<MockHandler> > chs;
+  std::vector<TCPClient> cls;
+  std::vector<TCPSocket> css;
+  for (int i = 0; i < N; i++) {
+    chs.push_back(linear::shared_ptr<MockHandler>(new MockHandler()));
+    cls.push_back(TCPClient(chs[i]));
+    css.push_back(cls[i].CreateSocket(TEST_ADDR, TEST_PORT));
+  }
+
+  Error e;
+  for (int i = 0; i < 3; i++) {
+    e = sv.Start(TEST_ADDR, TEST_PORT);
+    if (e == linear::Error(LNR_OK)) {
+      break;
+    }
+    msleep(100);
+  }
+  ASSERT_EQ(LNR_OK, e.Code());
+
+  volatile int connected = 0;
+  volatile int disconnected = 0;
+  EXPECT_CALL(*sh, OnConnectMock(_))
+    .Times(N);
+  EXPECT_CALL(*sh, OnMessageMock(_, _))
+    .Times(N)
+    .WillRepeatedly(WithArg<0>(Disconnect()));
+  EXPECT_CALL(*sh, OnDisconnectMock(_, _))
+    .Times(N);
+  for (int i = 0; i < N; i++) {
+    EXPECT_CALL(*chs[i], OnConnectMock(css[i]))
+      .WillOnce(CountUp(&connected));
+    EXPECT_CALL(*chs[i], OnDisconnectMock(css[i], _))
+      .WillOnce(CountUp(&disconnected));
+    e = css[i].SetWriteCoalescing(true);
+    ASSERT_EQ(LNR_OK, e.Code());
+    e = css[i].Connect();
+    ASSERT_EQ(LNR_OK, e.Code());
+  }
+  while (connected < N) {
+    msleep(1);
+  }
+  for (int i = 0; i < N; i++) {
+    Group::Join(GROUP_NAME, css[i]);
+  }
+
+  size_t packed = SharedBuffer::GetPackedCount();
+  Notify notif(std::string(METHOD_NAME), Params());
+  notif.Send(GROUP_NAME);
+  ASSERT_EQ(packed + 1, SharedBuffer::GetPackedCount());
+  while (disconnected < N) {
+    msleep(1);
+  }
+  while (!Group::Get(GROUP_NAME).empty()) {
+    msleep(1);
+  }
+
+  // check messages
+  type::any params = Params();
+  ASSERT_TRUE(sh->m_ != NULL);
+  ASSERT_EQ(NOTIFY, sh->m_->type);
+  Notify recv_notif = sh->m_->as<Notify>();
+  ASSERT_EQ(notif.method, recv_notif.method);
+  ASSERT_EQ(params, recv_notif.params);
+}
+
 #ifndef _WIN32
 // Recv malformed packet, issue #149: https://github.com/msgpack/msgpack-c/issues/149
 TEST_F(TCPClientServerSendRecvTest, MalformedPacket) {
@@ -795,6 +1248,102 @@ TEST_F(TCPClientServerSendRecvTest, MalformedPacket) {
   WAIT_SRV_TESTED();
   close(fd);
 }
+
+MATCHER_P(IsNotifyWith, params, "") {
+  return (arg.type == NOTIFY && arg.template as<Notify>().params == linear::type::any(params));
+}
+
+static int ConnectRaw() {
+  struct sockaddr_in s;
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  s.sin_family = AF_INET;
+  s.sin_port = htons(TEST_PORT);
+  s.sin_addr.s_addr = inet_addr(TEST_ADDR);
+  if (connect(fd, (struct sockaddr *)&s, sizeof(s)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Recv a message split into two reads
+TEST_F(TCPClientServerSendRecvTest, SplitMessage) {
+  shared_ptr<MockHandler> sh = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPServer sv(sh);
+
+  Error e;
+  for (int i = 0; i < 3; i++) {
+    e = sv.Start(TEST_ADDR, TEST_PORT);
+    if (e == linear::Error(LNR_OK)) {
+      break;
+    }
+    msleep(100);
+  }
+  ASSERT_EQ(LNR_OK, e.Code());
+
+  Params params;
+  params.e = std::string(4096, 'a'); // referred from the receive buffer when not split
+  msgpack::sbuffer packed;
+  msgpack::pack(packed, Notify(std::string(METHOD_NAME), params));
+
+  EXPECT_CALL(*sh, OnConnectMock(_));
+  EXPECT_CALL(*sh, OnMessageMock(_, IsNotifyWith(params)))
+    .WillOnce(Assign(&srv_tested, true));
+  EXPECT_CALL(*sh, OnDisconnectMock(_, _));
+
+  int fd = ConnectRaw();
+  ASSERT_LE(0, fd);
+  size_t half = packed.size() / 2;
+  ASSERT_EQ(half, (size_t)write(fd, packed.data(), half));
+  msleep(100);
+  ASSERT_EQ(packed.size() - half, (size_t)write(fd, packed.data() + half, packed.size() - half));
+  WAIT_SRV_TESTED();
+  close(fd);
+  sv.Stop();
+}
+
+// Recv a complete message and a partial one in a read
+TEST_F(TCPClientServerSendRecvTest, CompleteAndPartialMessage) {
+  shared_ptr<MockHandler> sh = linear::shared_ptr<MockHandler>(new MockHandler());
+  TCPServer sv(sh);
+
+  Error e;
+  for (int i = 0; i < 3; i++) {
+    e = sv.Start(TEST_ADDR, TEST_PORT);
+    if (e == linear::Error(LNR_OK)) {
+      break;
+    }
+    msleep(100);
+  }
+  ASSERT_EQ(LNR_OK, e.Code());
+
+  Params first, second;
+  first.e = std::string(2048, 'a');
+  second.e = std::string(64, 'b');
+  msgpack::sbuffer packed;
+  msgpack::pack(packed, Notify(std::string(METHOD_NAME), first));
+  size_t first_size = packed.size();
+  msgpack::pack(packed, Notify(std::string(METHOD_NAME), second));
+
+  {
+    InSequence dummy;
+    EXPECT_CALL(*sh, OnConnectMock(_));
+    EXPECT_CALL(*sh, OnMessageMock(_, IsNotifyWith(first)));
+    EXPECT_CALL(*sh, OnMessageMock(_, IsNotifyWith(second)))
+      .WillOnce(Assign(&srv_tested, true));
+    EXPECT_CALL(*sh, OnDisconnectMock(_, _));
+  }
+
+  int fd = ConnectRaw();
+  ASSERT_LE(0, fd);
+  size_t split = first_size + (packed.size() - first_size) / 2;
+  ASSERT_EQ(split, (size_t)write(fd, packed.data(), split));
+  msleep(100);
+  ASSERT_EQ(packed.size() - split, (size_t)write(fd, packed.data() + split, packed.size() - split));
+  WAIT_SRV_TESTED();
+  close(fd);
+  sv.Stop();
+}
 #endif
 
 // Overflow SendBuffer
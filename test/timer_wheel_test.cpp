@@ -0,0 +1,118 @@
+#include "gtest/gtest.h"
+
+#include "test_common.h"
+
+#include <vector>
+
+#include "linear/event_loop.h"
+#include "linear/mutex.h"
+
+#include "timer_wheel.h"
+
+typedef LinearTest TimerWheelTest;
+
+class Fired : public linear::TimerWheel::Entry {
+ public:
+  Fired(int i, std::vector<int>* o, linear::mutex* m) : id(i), order(o), mutex(m) {}
+  int id;
+  std::vector<int>* order;
+  linear::mutex* mutex;
+};
+
+static void onFired(void* args) {
+  Fired* entry = reinterpret_cast<Fired*>(args);
+  linear::lock_guard<linear::mutex> lock(*entry->mutex);
+  entry->order->push_back(entry->id);
+}
+
+static size_t firedCount(std::vector<int>* order, linear::mutex* mutex) {
+  linear::lock_guard<linear::mutex> lock(*mutex);
+  return order->size();
+}
+
+TEST_F(TimerWheelTest, expiryOrder) {
+  linear::EventLoop loop;
+  linear::shared_ptr<linear::TimerWheel> wheel = loop.GetImpl()->GetTimerWheel();
+  std::vector<int> order;
+  linear::mutex mutex;
+  Fired e30(30, &order, &mutex), e10(10, &order, &mutex), e20(20, &order, &mutex);
+  ASSERT_EQ(linear::LNR_OK, wheel->Add(&e30, onFired, 30, &e30).Code());
+  ASSERT_EQ(linear::LNR_OK, wheel->Add(&e10, onFired, 10, &e10).Code());
+  ASSERT_EQ(linear::LNR_OK, wheel->Add(&e20, onFired, 20, &e20).Code());
+  for (int i = 0; i < 1000 && firedCount(&order, &mutex) < 3; i++) {
+    msleep(1);
+  }
+  linear::lock_guard<linear::mutex> guard(mutex);
+  ASSERT_EQ(3U, order.size());
+  ASSERT_EQ(10, order[0]);
+  ASSERT_EQ(20, order[1]);
+  ASSERT_EQ(30, order[2]);
+}
+
+TEST_F(TimerWheelTest, removeBeforeFire) {
+  linear::EventLoop loop;
+  linear::shared_ptr<linear::TimerWheel> wheel = loop.GetImpl()->GetTimerWheel();
+  std::vector<int> order;
+  linear::mutex mutex;
+  Fired removed(1, &order, &mutex), kept(2, &order, &mutex);
+  ASSERT_EQ(linear::LNR_OK, wheel->Add(&removed, onFired, 10, &removed).Code());
+  ASSERT_EQ(linear::LNR_OK, wheel->Add(&kept, onFired, 50, &kept).Code());
+  wheel->Remove(&removed);
+  for (int i = 0; i < 1000 && firedCount(&order, &mutex) < 1; i++) {
+    msleep(1);
+  }
+  msleep(20);
+  linear::lock_guard<linear::mutex> guard(mutex);
+  ASSERT_EQ(1U, order.size());
+  ASSERT_EQ(2, order[0]);
+}
+
+TEST_F(TimerWheelTest, longerThanRevolution) {
+  linear::EventLoop loop;
+  linear::shared_ptr<linear::TimerWheel> wheel = loop.GetImpl()->GetTimerWheel();
+  std::vector<int> order;
+  linear::mutex mutex;
+  // the root wheel covers 256 msec, so the entry is cascaded from the next level
+  Fired entry(1, &order, &mutex);
+  ASSERT_EQ(linear::LNR_OK, wheel->Add(&entry, onFired, 300, &entry).Code());
+  msleep(250);
+  ASSERT_EQ(0U, firedCount(&order, &mutex));
+  for (int i = 0; i < 2000 && firedCount(&order, &mutex) < 1; i++) {
+    msleep(1);
+  }
+  ASSERT_EQ(1U, firedCount(&order, &mutex));
+}
+
+static const int ALIVE = 0x600d;
+static const int DEAD = 0xdead;
+
+class Guarded : public linear::TimerWheel::Entry {
+ public:
+  Guarded(volatile int* b) : magic(ALIVE), bad(b) {}
+  volatile int magic;
+  volatile int* bad;
+};
+
+static void onGuarded(void* args) {
+  Guarded* entry = reinterpret_cast<Guarded*>(args);
+  msleep(1); // widen the window for Remove to run concurrently
+  if (entry->magic != ALIVE) {
+    (*entry->bad)++;
+  }
+}
+
+TEST_F(TimerWheelTest, removeRacingWithFire) {
+  linear::EventLoop loop;
+  linear::shared_ptr<linear::TimerWheel> wheel = loop.GetImpl()->GetTimerWheel();
+  volatile int bad = 0;
+  for (int i = 0; i < 200; i++) {
+    Guarded* entry = new Guarded(&bad);
+    ASSERT_EQ(linear::LNR_OK, wheel->Add(entry, onGuarded, 1, entry).Code());
+    msleep(i % 3);
+    // after Remove the callback must not be running, so the entry can be deleted
+    wheel->Remove(entry);
+    entry->magic = DEAD;
+    delete entry;
+  }
+  ASSERT_EQ(0, bad);
+}
@@ -0,0 +1,139 @@
+#include "gtest/gtest.h"
+
+#include "test_common.h"
+
+#include <vector>
+
+#include "linear/condition_variable.h"
+
+#include "worker_pool_impl.h"
+
+typedef LinearTest WorkerPoolTest;
+
+// runs until Open is called
+class Gate {
+ public:
+  Gate() : entered_(false), opened_(false) {}
+  void Pass() {
+    linear::unique_lock<linear::mutex> guard(mutex_);
+    entered_ = true;
+    cond_.notify_all();
+    while (!opened_) {
+      cond_.wait(guard);
+    }
+  }
+  void WaitEntered() {
+    linear::unique_lock<linear::mutex> guard(mutex_);
+    while (!entered_) {
+      cond_.wait(guard);
+    }
+  }
+  void Open() {
+    linear::lock_guard<linear::mutex> guard(mutex_);
+    opened_ = true;
+    cond_.notify_all();
+  }
+
+ private:
+  bool entered_;
+  bool opened_;
+  linear::mutex mutex_;
+  linear::condition_variable cond_;
+};
+
+class GateTask : public linear::WorkerPoolImpl::Task {
+ public:
+  GateTask(Gate* gate) : gate_(gate) {}
+  void Run() {
+    gate_->Pass();
+  }
+ private:
+  Gate* gate_;
+};
+
+class RecordTask : public linear::WorkerPoolImpl::Task {
+ public:
+  RecordTask(int value, std::vector<int>* values, linear::mutex* mutex)
+    : value_(value), values_(values), mutex_(mutex) {}
+  void Run() {
+    linear::lock_guard<linear::mutex> guard(*mutex_);
+    values_->push_back(value_);
+  }
+ private:
+  int value_;
+  std::vector<int>* values_;
+  linear::mutex* mutex_;
+};
+
+TEST_F(WorkerPoolTest, strandOrder) {
+  std::vector<int> values;
+  linear::mutex mutex;
+  {
+    linear::WorkerPoolImpl pool(4, 1024);
+    for (int i = 0; i < 100; i++) {
+      ASSERT_EQ(linear::LNR_OK, pool.Post(1, new RecordTask(i, &values, &mutex), true).Code());
+    }
+  } // workers run what is already queued before they exit
+  ASSERT_EQ(100U, values.size());
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(i, values[i]);
+  }
+}
+
+TEST_F(WorkerPoolTest, rejectWhenFull) {
+  Gate gate;
+  std::vector<int> values;
+  linear::mutex mutex;
+  {
+    linear::WorkerPoolImpl pool(1, 2);
+    ASSERT_EQ(linear::LNR_OK, pool.Post(1, new GateTask(&gate), true).Code());
+    gate.WaitEntered(); // the only worker is busy
+    ASSERT_EQ(linear::LNR_OK, pool.Post(2, new RecordTask(1, &values, &mutex), true).Code());
+    ASSERT_EQ(linear::LNR_OK, pool.Post(2, new RecordTask(2, &values, &mutex), true).Code());
+    ASSERT_EQ(2U, pool.GetQueueDepth());
+
+    // full: dropped without waiting for room
+    ASSERT_EQ(linear::LNR_ENOBUFS, pool.Post(2, new RecordTask(3, &values, &mutex), true).Code());
+    ASSERT_EQ(1U, pool.GetRejectedCount());
+    // not droppable: queued beyond the limit
+    ASSERT_EQ(linear::LNR_OK, pool.Post(2, new RecordTask(4, &values, &mutex), false).Code());
+    ASSERT_EQ(3U, pool.GetQueueDepth());
+    ASSERT_EQ(3U, pool.GetPeakQueueDepth());
+    gate.Open();
+  }
+  ASSERT_EQ(3U, values.size());
+  ASSERT_EQ(1, values[0]);
+  ASSERT_EQ(2, values[1]);
+  ASSERT_EQ(4, values[2]);
+}
+
+// a callback running on a worker may lead to another callback (e.g. Send fails and calls OnError)
+class RepostTask : public linear::WorkerPoolImpl::Task {
+ public:
+  RepostTask(linear::WorkerPoolImpl* pool, std::vector<int>* values, linear::mutex* mutex)
+    : pool_(pool), values_(values), mutex_(mutex) {}
+  void Run() {
+    for (int i = 0; i < 4; i++) {
+      pool_->Post(1, new RecordTask(i, values_, mutex_), true);
+    }
+  }
+ private:
+  linear::WorkerPoolImpl* pool_;
+  std::vector<int>* values_;
+  linear::mutex* mutex_;
+};
+
+TEST_F(WorkerPoolTest, postFromWorker) {
+  std::vector<int> values;
+  linear::mutex mutex;
+  {
+    linear::WorkerPoolImpl pool(1, 1);
+    ASSERT_EQ(linear::LNR_OK, pool.Post(1, new RepostTask(&pool, &values, &mutex), true).Code());
+    // the only worker must not wait for itself to make room
+    for (int i = 0; i < 1000 && pool.GetRejectedCount() < 3; i++) {
+      msleep(1);
+    }
+    ASSERT_EQ(3U, pool.GetRejectedCount());
+  }
+  ASSERT_EQ(1U, values.size());
+}